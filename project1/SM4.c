@@ -1,95 +1,1390 @@
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define SM4_X86 1
+#include <immintrin.h>
+#include <x86intrin.h>
+#endif
 
-#define BLOCK_SIZE 16  
+#include "sm4.h"
 
-const uint32_t Sbox[] = {
-    0xD6, 0x90, 0xE9, 0xFE, 0xCC, 0x5D, 0x11, 0x9A, 0x6F, 0x8B, 0xB3, 0x37, 0x7E, 0xF0, 0x93, 0xC5,
-    0x77, 0xAD, 0xC7, 0x02, 0x1B, 0x93, 0x58, 0x25, 0xC5, 0xB9, 0xE2, 0xD0, 0x5A, 0xBB, 0x96, 0x94
+#define ROTL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+// SM4 S盒（GB/T 32907-2016）
+static const uint8_t Sbox[256] = {
+    0xD6, 0x90, 0xE9, 0xFE, 0xCC, 0xE1, 0x3D, 0xB7, 0x16, 0xB6, 0x14, 0xC2, 0x28, 0xFB, 0x2C, 0x05,
+    0x2B, 0x67, 0x9A, 0x76, 0x2A, 0xBE, 0x04, 0xC3, 0xAA, 0x44, 0x13, 0x26, 0x49, 0x86, 0x06, 0x99,
+    0x9C, 0x42, 0x50, 0xF4, 0x91, 0xEF, 0x98, 0x7A, 0x33, 0x54, 0x0B, 0x43, 0xED, 0xCF, 0xAC, 0x62,
+    0xE4, 0xB3, 0x1C, 0xA9, 0xC9, 0x08, 0xE8, 0x95, 0x80, 0xDF, 0x94, 0xFA, 0x75, 0x8F, 0x3F, 0xA6,
+    0x47, 0x07, 0xA7, 0xFC, 0xF3, 0x73, 0x17, 0xBA, 0x83, 0x59, 0x3C, 0x19, 0xE6, 0x85, 0x4F, 0xA8,
+    0x68, 0x6B, 0x81, 0xB2, 0x71, 0x64, 0xDA, 0x8B, 0xF8, 0xEB, 0x0F, 0x4B, 0x70, 0x56, 0x9D, 0x35,
+    0x1E, 0x24, 0x0E, 0x5E, 0x63, 0x58, 0xD1, 0xA2, 0x25, 0x22, 0x7C, 0x3B, 0x01, 0x21, 0x78, 0x87,
+    0xD4, 0x00, 0x46, 0x57, 0x9F, 0xD3, 0x27, 0x52, 0x4C, 0x36, 0x02, 0xE7, 0xA0, 0xC4, 0xC8, 0x9E,
+    0xEA, 0xBF, 0x8A, 0xD2, 0x40, 0xC7, 0x38, 0xB5, 0xA3, 0xF7, 0xF2, 0xCE, 0xF9, 0x61, 0x15, 0xA1,
+    0xE0, 0xAE, 0x5D, 0xA4, 0x9B, 0x34, 0x1A, 0x55, 0xAD, 0x93, 0x32, 0x30, 0xF5, 0x8C, 0xB1, 0xE3,
+    0x1D, 0xF6, 0xE2, 0x2E, 0x82, 0x66, 0xCA, 0x60, 0xC0, 0x29, 0x23, 0xAB, 0x0D, 0x53, 0x4E, 0x6F,
+    0xD5, 0xDB, 0x37, 0x45, 0xDE, 0xFD, 0x8E, 0x2F, 0x03, 0xFF, 0x6A, 0x72, 0x6D, 0x6C, 0x5B, 0x51,
+    0x8D, 0x1B, 0xAF, 0x92, 0xBB, 0xDD, 0xBC, 0x7F, 0x11, 0xD9, 0x5C, 0x41, 0x1F, 0x10, 0x5A, 0xD8,
+    0x0A, 0xC1, 0x31, 0x88, 0xA5, 0xCD, 0x7B, 0xBD, 0x2D, 0x74, 0xD0, 0x12, 0xB8, 0xE5, 0xB4, 0xB0,
+    0x89, 0x69, 0x97, 0x4A, 0x0C, 0x96, 0x77, 0x7E, 0x65, 0xB9, 0xF1, 0x09, 0xC5, 0x6E, 0xC6, 0x84,
+    0x18, 0xF0, 0x7D, 0xEC, 0x3A, 0xDC, 0x4D, 0x20, 0x79, 0xEE, 0x5F, 0x3E, 0xD7, 0xCB, 0x39, 0x48
+};
+
+// 系统参数 FK
+static const uint32_t FK[4] = {
+    0xA3B1BAC6, 0x56AA3350, 0x677D9197, 0xB27022DC
+};
+
+// 固定参数 CK：ck(i,j) = (4i + j) * 7 mod 256
+static const uint32_t CK[32] = {
+    0x00070E15, 0x1C232A31, 0x383F464D, 0x545B6269, 0x70777E85, 0x8C939AA1, 0xA8AFB6BD, 0xC4CBD2D9,
+    0xE0E7EEF5, 0xFC030A11, 0x181F262D, 0x343B4249, 0x50575E65, 0x6C737A81, 0x888F969D, 0xA4ABB2B9,
+    0xC0C7CED5, 0xDCE3EAF1, 0xF8FF060D, 0x141B2229, 0x30373E45, 0x4C535A61, 0x686F767D, 0x848B9299,
+    0xA0A7AEB5, 0xBCC3CAD1, 0xD8DFE6ED, 0xF4FB0209, 0x10171E25, 0x2C333A41, 0x484F565D, 0x646B7279
+};
+
+// T 表：把 S 盒与线性变换 L 合并为一次查表，SM4_T0[x] = L(S(x) << 24)，
+// SM4_T1..T3 依次对应次高字节到最低字节，T(x) = T0[x0] ^ T1[x1] ^ T2[x2] ^ T3[x3]
+// 定义 SM4_SMALL_TTABLE 时只保留 1 KB 的 SM4_T0，其余三张表由循环移位得到（L 与循环移位可交换）
+static const uint32_t SM4_T0[256] = {
+    0x8ED55B5B, 0xD0924242, 0x4DEAA7A7, 0x06FDFBFB, 0xFCCF3333, 0x65E28787, 0xC93DF4F4, 0x6BB5DEDE,
+    0x4E165858, 0x6EB4DADA, 0x44145050, 0xCAC10B0B, 0x8828A0A0, 0x17F8EFEF, 0x9C2CB0B0, 0x11051414,
+    0x872BACAC, 0xFB669D9D, 0xF2986A6A, 0xAE77D9D9, 0x822AA8A8, 0x46BCFAFA, 0x14041010, 0xCFC00F0F,
+    0x02A8AAAA, 0x54451111, 0x5F134C4C, 0xBE269898, 0x6D482525, 0x9E841A1A, 0x1E061818, 0xFD9B6666,
+    0xEC9E7272, 0x4A430909, 0x10514141, 0x24F7D3D3, 0xD5934646, 0x53ECBFBF, 0xF89A6262, 0x927BE9E9,
+    0xFF33CCCC, 0x04555151, 0x270B2C2C, 0x4F420D0D, 0x59EEB7B7, 0xF3CC3F3F, 0x1CAEB2B2, 0xEA638989,
+    0x74E79393, 0x7FB1CECE, 0x6C1C7070, 0x0DABA6A6, 0xEDCA2727, 0x28082020, 0x48EBA3A3, 0xC1975656,
+    0x80820202, 0xA3DC7F7F, 0xC4965252, 0x12F9EBEB, 0xA174D5D5, 0xB38D3E3E, 0xC33FFCFC, 0x3EA49A9A,
+    0x5B461D1D, 0x1B071C1C, 0x3BA59E9E, 0x0CFFF3F3, 0x3FF0CFCF, 0xBF72CDCD, 0x4B175C5C, 0x52B8EAEA,
+    0x8F810E0E, 0x3D586565, 0xCC3CF0F0, 0x7D196464, 0x7EE59B9B, 0x91871616, 0x734E3D3D, 0x08AAA2A2,
+    0xC869A1A1, 0xC76AADAD, 0x85830606, 0x7AB0CACA, 0xB570C5C5, 0xF4659191, 0xB2D96B6B, 0xA7892E2E,
+    0x18FBE3E3, 0x47E8AFAF, 0x330F3C3C, 0x674A2D2D, 0xB071C1C1, 0x0E575959, 0xE99F7676, 0xE135D4D4,
+    0x661E7878, 0xB4249090, 0x360E3838, 0x265F7979, 0xEF628D8D, 0x38596161, 0x95D24747, 0x2AA08A8A,
+    0xB1259494, 0xAA228888, 0x8C7DF1F1, 0xD73BECEC, 0x05010404, 0xA5218484, 0x9879E1E1, 0x9B851E1E,
+    0x84D75353, 0x00000000, 0x5E471919, 0x0B565D5D, 0xE39D7E7E, 0x9FD04F4F, 0xBB279C9C, 0x1A534949,
+    0x7C4D3131, 0xEE36D8D8, 0x0A020808, 0x7BE49F9F, 0x20A28282, 0xD4C71313, 0xE8CB2323, 0xE69C7A7A,
+    0x42E9ABAB, 0x43BDFEFE, 0xA2882A2A, 0x9AD14B4B, 0x40410101, 0xDBC41F1F, 0xD838E0E0, 0x61B7D6D6,
+    0x2FA18E8E, 0x2BF4DFDF, 0x3AF1CBCB, 0xF6CD3B3B, 0x1DFAE7E7, 0xE5608585, 0x41155454, 0x25A38686,
+    0x60E38383, 0x16ACBABA, 0x295C7575, 0x34A69292, 0xF7996E6E, 0xE434D0D0, 0x721A6868, 0x01545555,
+    0x19AFB6B6, 0xDF914E4E, 0xFA32C8C8, 0xF030C0C0, 0x21F6D7D7, 0xBC8E3232, 0x75B3C6C6, 0x6FE08F8F,
+    0x691D7474, 0x2EF5DBDB, 0x6AE18B8B, 0x962EB8B8, 0x8A800A0A, 0xFE679999, 0xE2C92B2B, 0xE0618181,
+    0xC0C30303, 0x8D29A4A4, 0xAF238C8C, 0x07A9AEAE, 0x390D3434, 0x1F524D4D, 0x764F3939, 0xD36EBDBD,
+    0x81D65757, 0xB7D86F6F, 0xEB37DCDC, 0x51441515, 0xA6DD7B7B, 0x09FEF7F7, 0xB68C3A3A, 0x932FBCBC,
+    0x0F030C0C, 0x03FCFFFF, 0xC26BA9A9, 0xBA73C9C9, 0xD96CB5B5, 0xDC6DB1B1, 0x375A6D6D, 0x15504545,
+    0xB98F3636, 0x771B6C6C, 0x13ADBEBE, 0xDA904A4A, 0x57B9EEEE, 0xA9DE7777, 0x4CBEF2F2, 0x837EFDFD,
+    0x55114444, 0xBDDA6767, 0x2C5D7171, 0x45400505, 0x631F7C7C, 0x50104040, 0x325B6969, 0xB8DB6363,
+    0x220A2828, 0xC5C20707, 0xF531C4C4, 0xA88A2222, 0x31A79696, 0xF9CE3737, 0x977AEDED, 0x49BFF6F6,
+    0x992DB4B4, 0xA475D1D1, 0x90D34343, 0x5A124848, 0x58BAE2E2, 0x71E69797, 0x64B6D2D2, 0x70B2C2C2,
+    0xAD8B2626, 0xCD68A5A5, 0xCB955E5E, 0x624B2929, 0x3C0C3030, 0xCE945A5A, 0xAB76DDDD, 0x867FF9F9,
+    0xF1649595, 0x5DBBE6E6, 0x35F2C7C7, 0x2D092424, 0xD1C61717, 0xD66FB9B9, 0xDEC51B1B, 0x94861212,
+    0x78186060, 0x30F3C3C3, 0x897CF5F5, 0x5CEFB3B3, 0xD23AE8E8, 0xACDF7373, 0x794C3535, 0xA0208080,
+    0x9D78E5E5, 0x56EDBBBB, 0x235E7D7D, 0xC63EF8F8, 0x8BD45F5F, 0xE7C82F2F, 0xDD39E4E4, 0x68492121
+};
+
+#ifndef SM4_SMALL_TTABLE
+static const uint32_t SM4_T1[256] = {
+    0x5B8ED55B, 0x42D09242, 0xA74DEAA7, 0xFB06FDFB, 0x33FCCF33, 0x8765E287, 0xF4C93DF4, 0xDE6BB5DE,
+    0x584E1658, 0xDA6EB4DA, 0x50441450, 0x0BCAC10B, 0xA08828A0, 0xEF17F8EF, 0xB09C2CB0, 0x14110514,
+    0xAC872BAC, 0x9DFB669D, 0x6AF2986A, 0xD9AE77D9, 0xA8822AA8, 0xFA46BCFA, 0x10140410, 0x0FCFC00F,
+    0xAA02A8AA, 0x11544511, 0x4C5F134C, 0x98BE2698, 0x256D4825, 0x1A9E841A, 0x181E0618, 0x66FD9B66,
+    0x72EC9E72, 0x094A4309, 0x41105141, 0xD324F7D3, 0x46D59346, 0xBF53ECBF, 0x62F89A62, 0xE9927BE9,
+    0xCCFF33CC, 0x51045551, 0x2C270B2C, 0x0D4F420D, 0xB759EEB7, 0x3FF3CC3F, 0xB21CAEB2, 0x89EA6389,
+    0x9374E793, 0xCE7FB1CE, 0x706C1C70, 0xA60DABA6, 0x27EDCA27, 0x20280820, 0xA348EBA3, 0x56C19756,
+    0x02808202, 0x7FA3DC7F, 0x52C49652, 0xEB12F9EB, 0xD5A174D5, 0x3EB38D3E, 0xFCC33FFC, 0x9A3EA49A,
+    0x1D5B461D, 0x1C1B071C, 0x9E3BA59E, 0xF30CFFF3, 0xCF3FF0CF, 0xCDBF72CD, 0x5C4B175C, 0xEA52B8EA,
+    0x0E8F810E, 0x653D5865, 0xF0CC3CF0, 0x647D1964, 0x9B7EE59B, 0x16918716, 0x3D734E3D, 0xA208AAA2,
+    0xA1C869A1, 0xADC76AAD, 0x06858306, 0xCA7AB0CA, 0xC5B570C5, 0x91F46591, 0x6BB2D96B, 0x2EA7892E,
+    0xE318FBE3, 0xAF47E8AF, 0x3C330F3C, 0x2D674A2D, 0xC1B071C1, 0x590E5759, 0x76E99F76, 0xD4E135D4,
+    0x78661E78, 0x90B42490, 0x38360E38, 0x79265F79, 0x8DEF628D, 0x61385961, 0x4795D247, 0x8A2AA08A,
+    0x94B12594, 0x88AA2288, 0xF18C7DF1, 0xECD73BEC, 0x04050104, 0x84A52184, 0xE19879E1, 0x1E9B851E,
+    0x5384D753, 0x00000000, 0x195E4719, 0x5D0B565D, 0x7EE39D7E, 0x4F9FD04F, 0x9CBB279C, 0x491A5349,
+    0x317C4D31, 0xD8EE36D8, 0x080A0208, 0x9F7BE49F, 0x8220A282, 0x13D4C713, 0x23E8CB23, 0x7AE69C7A,
+    0xAB42E9AB, 0xFE43BDFE, 0x2AA2882A, 0x4B9AD14B, 0x01404101, 0x1FDBC41F, 0xE0D838E0, 0xD661B7D6,
+    0x8E2FA18E, 0xDF2BF4DF, 0xCB3AF1CB, 0x3BF6CD3B, 0xE71DFAE7, 0x85E56085, 0x54411554, 0x8625A386,
+    0x8360E383, 0xBA16ACBA, 0x75295C75, 0x9234A692, 0x6EF7996E, 0xD0E434D0, 0x68721A68, 0x55015455,
+    0xB619AFB6, 0x4EDF914E, 0xC8FA32C8, 0xC0F030C0, 0xD721F6D7, 0x32BC8E32, 0xC675B3C6, 0x8F6FE08F,
+    0x74691D74, 0xDB2EF5DB, 0x8B6AE18B, 0xB8962EB8, 0x0A8A800A, 0x99FE6799, 0x2BE2C92B, 0x81E06181,
+    0x03C0C303, 0xA48D29A4, 0x8CAF238C, 0xAE07A9AE, 0x34390D34, 0x4D1F524D, 0x39764F39, 0xBDD36EBD,
+    0x5781D657, 0x6FB7D86F, 0xDCEB37DC, 0x15514415, 0x7BA6DD7B, 0xF709FEF7, 0x3AB68C3A, 0xBC932FBC,
+    0x0C0F030C, 0xFF03FCFF, 0xA9C26BA9, 0xC9BA73C9, 0xB5D96CB5, 0xB1DC6DB1, 0x6D375A6D, 0x45155045,
+    0x36B98F36, 0x6C771B6C, 0xBE13ADBE, 0x4ADA904A, 0xEE57B9EE, 0x77A9DE77, 0xF24CBEF2, 0xFD837EFD,
+    0x44551144, 0x67BDDA67, 0x712C5D71, 0x05454005, 0x7C631F7C, 0x40501040, 0x69325B69, 0x63B8DB63,
+    0x28220A28, 0x07C5C207, 0xC4F531C4, 0x22A88A22, 0x9631A796, 0x37F9CE37, 0xED977AED, 0xF649BFF6,
+    0xB4992DB4, 0xD1A475D1, 0x4390D343, 0x485A1248, 0xE258BAE2, 0x9771E697, 0xD264B6D2, 0xC270B2C2,
+    0x26AD8B26, 0xA5CD68A5, 0x5ECB955E, 0x29624B29, 0x303C0C30, 0x5ACE945A, 0xDDAB76DD, 0xF9867FF9,
+    0x95F16495, 0xE65DBBE6, 0xC735F2C7, 0x242D0924, 0x17D1C617, 0xB9D66FB9, 0x1BDEC51B, 0x12948612,
+    0x60781860, 0xC330F3C3, 0xF5897CF5, 0xB35CEFB3, 0xE8D23AE8, 0x73ACDF73, 0x35794C35, 0x80A02080,
+    0xE59D78E5, 0xBB56EDBB, 0x7D235E7D, 0xF8C63EF8, 0x5F8BD45F, 0x2FE7C82F, 0xE4DD39E4, 0x21684921
+};
+
+static const uint32_t SM4_T2[256] = {
+    0x5B5B8ED5, 0x4242D092, 0xA7A74DEA, 0xFBFB06FD, 0x3333FCCF, 0x878765E2, 0xF4F4C93D, 0xDEDE6BB5,
+    0x58584E16, 0xDADA6EB4, 0x50504414, 0x0B0BCAC1, 0xA0A08828, 0xEFEF17F8, 0xB0B09C2C, 0x14141105,
+    0xACAC872B, 0x9D9DFB66, 0x6A6AF298, 0xD9D9AE77, 0xA8A8822A, 0xFAFA46BC, 0x10101404, 0x0F0FCFC0,
+    0xAAAA02A8, 0x11115445, 0x4C4C5F13, 0x9898BE26, 0x25256D48, 0x1A1A9E84, 0x18181E06, 0x6666FD9B,
+    0x7272EC9E, 0x09094A43, 0x41411051, 0xD3D324F7, 0x4646D593, 0xBFBF53EC, 0x6262F89A, 0xE9E9927B,
+    0xCCCCFF33, 0x51510455, 0x2C2C270B, 0x0D0D4F42, 0xB7B759EE, 0x3F3FF3CC, 0xB2B21CAE, 0x8989EA63,
+    0x939374E7, 0xCECE7FB1, 0x70706C1C, 0xA6A60DAB, 0x2727EDCA, 0x20202808, 0xA3A348EB, 0x5656C197,
+    0x02028082, 0x7F7FA3DC, 0x5252C496, 0xEBEB12F9, 0xD5D5A174, 0x3E3EB38D, 0xFCFCC33F, 0x9A9A3EA4,
+    0x1D1D5B46, 0x1C1C1B07, 0x9E9E3BA5, 0xF3F30CFF, 0xCFCF3FF0, 0xCDCDBF72, 0x5C5C4B17, 0xEAEA52B8,
+    0x0E0E8F81, 0x65653D58, 0xF0F0CC3C, 0x64647D19, 0x9B9B7EE5, 0x16169187, 0x3D3D734E, 0xA2A208AA,
+    0xA1A1C869, 0xADADC76A, 0x06068583, 0xCACA7AB0, 0xC5C5B570, 0x9191F465, 0x6B6BB2D9, 0x2E2EA789,
+    0xE3E318FB, 0xAFAF47E8, 0x3C3C330F, 0x2D2D674A, 0xC1C1B071, 0x59590E57, 0x7676E99F, 0xD4D4E135,
+    0x7878661E, 0x9090B424, 0x3838360E, 0x7979265F, 0x8D8DEF62, 0x61613859, 0x474795D2, 0x8A8A2AA0,
+    0x9494B125, 0x8888AA22, 0xF1F18C7D, 0xECECD73B, 0x04040501, 0x8484A521, 0xE1E19879, 0x1E1E9B85,
+    0x535384D7, 0x00000000, 0x19195E47, 0x5D5D0B56, 0x7E7EE39D, 0x4F4F9FD0, 0x9C9CBB27, 0x49491A53,
+    0x31317C4D, 0xD8D8EE36, 0x08080A02, 0x9F9F7BE4, 0x828220A2, 0x1313D4C7, 0x2323E8CB, 0x7A7AE69C,
+    0xABAB42E9, 0xFEFE43BD, 0x2A2AA288, 0x4B4B9AD1, 0x01014041, 0x1F1FDBC4, 0xE0E0D838, 0xD6D661B7,
+    0x8E8E2FA1, 0xDFDF2BF4, 0xCBCB3AF1, 0x3B3BF6CD, 0xE7E71DFA, 0x8585E560, 0x54544115, 0x868625A3,
+    0x838360E3, 0xBABA16AC, 0x7575295C, 0x929234A6, 0x6E6EF799, 0xD0D0E434, 0x6868721A, 0x55550154,
+    0xB6B619AF, 0x4E4EDF91, 0xC8C8FA32, 0xC0C0F030, 0xD7D721F6, 0x3232BC8E, 0xC6C675B3, 0x8F8F6FE0,
+    0x7474691D, 0xDBDB2EF5, 0x8B8B6AE1, 0xB8B8962E, 0x0A0A8A80, 0x9999FE67, 0x2B2BE2C9, 0x8181E061,
+    0x0303C0C3, 0xA4A48D29, 0x8C8CAF23, 0xAEAE07A9, 0x3434390D, 0x4D4D1F52, 0x3939764F, 0xBDBDD36E,
+    0x575781D6, 0x6F6FB7D8, 0xDCDCEB37, 0x15155144, 0x7B7BA6DD, 0xF7F709FE, 0x3A3AB68C, 0xBCBC932F,
+    0x0C0C0F03, 0xFFFF03FC, 0xA9A9C26B, 0xC9C9BA73, 0xB5B5D96C, 0xB1B1DC6D, 0x6D6D375A, 0x45451550,
+    0x3636B98F, 0x6C6C771B, 0xBEBE13AD, 0x4A4ADA90, 0xEEEE57B9, 0x7777A9DE, 0xF2F24CBE, 0xFDFD837E,
+    0x44445511, 0x6767BDDA, 0x71712C5D, 0x05054540, 0x7C7C631F, 0x40405010, 0x6969325B, 0x6363B8DB,
+    0x2828220A, 0x0707C5C2, 0xC4C4F531, 0x2222A88A, 0x969631A7, 0x3737F9CE, 0xEDED977A, 0xF6F649BF,
+    0xB4B4992D, 0xD1D1A475, 0x434390D3, 0x48485A12, 0xE2E258BA, 0x979771E6, 0xD2D264B6, 0xC2C270B2,
+    0x2626AD8B, 0xA5A5CD68, 0x5E5ECB95, 0x2929624B, 0x30303C0C, 0x5A5ACE94, 0xDDDDAB76, 0xF9F9867F,
+    0x9595F164, 0xE6E65DBB, 0xC7C735F2, 0x24242D09, 0x1717D1C6, 0xB9B9D66F, 0x1B1BDEC5, 0x12129486,
+    0x60607818, 0xC3C330F3, 0xF5F5897C, 0xB3B35CEF, 0xE8E8D23A, 0x7373ACDF, 0x3535794C, 0x8080A020,
+    0xE5E59D78, 0xBBBB56ED, 0x7D7D235E, 0xF8F8C63E, 0x5F5F8BD4, 0x2F2FE7C8, 0xE4E4DD39, 0x21216849
 };
 
-const uint32_t FK[32] = {
-    0xA3B1BAE9, 0x59DDA23E, 0x5C4DD124, 0x2F1BB5EA, 0xC9BC3CD2, 0x2883B8A3, 0x464860BD, 0x5141AB54,
-    0x18A915CF, 0x2F2DF196, 0x31E55A31, 0xC095CE8E, 0x1DE0D795, 0x590415F9, 0x758FE5EE, 0xC55AD21B
+static const uint32_t SM4_T3[256] = {
+    0xD55B5B8E, 0x924242D0, 0xEAA7A74D, 0xFDFBFB06, 0xCF3333FC, 0xE2878765, 0x3DF4F4C9, 0xB5DEDE6B,
+    0x1658584E, 0xB4DADA6E, 0x14505044, 0xC10B0BCA, 0x28A0A088, 0xF8EFEF17, 0x2CB0B09C, 0x05141411,
+    0x2BACAC87, 0x669D9DFB, 0x986A6AF2, 0x77D9D9AE, 0x2AA8A882, 0xBCFAFA46, 0x04101014, 0xC00F0FCF,
+    0xA8AAAA02, 0x45111154, 0x134C4C5F, 0x269898BE, 0x4825256D, 0x841A1A9E, 0x0618181E, 0x9B6666FD,
+    0x9E7272EC, 0x4309094A, 0x51414110, 0xF7D3D324, 0x934646D5, 0xECBFBF53, 0x9A6262F8, 0x7BE9E992,
+    0x33CCCCFF, 0x55515104, 0x0B2C2C27, 0x420D0D4F, 0xEEB7B759, 0xCC3F3FF3, 0xAEB2B21C, 0x638989EA,
+    0xE7939374, 0xB1CECE7F, 0x1C70706C, 0xABA6A60D, 0xCA2727ED, 0x08202028, 0xEBA3A348, 0x975656C1,
+    0x82020280, 0xDC7F7FA3, 0x965252C4, 0xF9EBEB12, 0x74D5D5A1, 0x8D3E3EB3, 0x3FFCFCC3, 0xA49A9A3E,
+    0x461D1D5B, 0x071C1C1B, 0xA59E9E3B, 0xFFF3F30C, 0xF0CFCF3F, 0x72CDCDBF, 0x175C5C4B, 0xB8EAEA52,
+    0x810E0E8F, 0x5865653D, 0x3CF0F0CC, 0x1964647D, 0xE59B9B7E, 0x87161691, 0x4E3D3D73, 0xAAA2A208,
+    0x69A1A1C8, 0x6AADADC7, 0x83060685, 0xB0CACA7A, 0x70C5C5B5, 0x659191F4, 0xD96B6BB2, 0x892E2EA7,
+    0xFBE3E318, 0xE8AFAF47, 0x0F3C3C33, 0x4A2D2D67, 0x71C1C1B0, 0x5759590E, 0x9F7676E9, 0x35D4D4E1,
+    0x1E787866, 0x249090B4, 0x0E383836, 0x5F797926, 0x628D8DEF, 0x59616138, 0xD2474795, 0xA08A8A2A,
+    0x259494B1, 0x228888AA, 0x7DF1F18C, 0x3BECECD7, 0x01040405, 0x218484A5, 0x79E1E198, 0x851E1E9B,
+    0xD7535384, 0x00000000, 0x4719195E, 0x565D5D0B, 0x9D7E7EE3, 0xD04F4F9F, 0x279C9CBB, 0x5349491A,
+    0x4D31317C, 0x36D8D8EE, 0x0208080A, 0xE49F9F7B, 0xA2828220, 0xC71313D4, 0xCB2323E8, 0x9C7A7AE6,
+    0xE9ABAB42, 0xBDFEFE43, 0x882A2AA2, 0xD14B4B9A, 0x41010140, 0xC41F1FDB, 0x38E0E0D8, 0xB7D6D661,
+    0xA18E8E2F, 0xF4DFDF2B, 0xF1CBCB3A, 0xCD3B3BF6, 0xFAE7E71D, 0x608585E5, 0x15545441, 0xA3868625,
+    0xE3838360, 0xACBABA16, 0x5C757529, 0xA6929234, 0x996E6EF7, 0x34D0D0E4, 0x1A686872, 0x54555501,
+    0xAFB6B619, 0x914E4EDF, 0x32C8C8FA, 0x30C0C0F0, 0xF6D7D721, 0x8E3232BC, 0xB3C6C675, 0xE08F8F6F,
+    0x1D747469, 0xF5DBDB2E, 0xE18B8B6A, 0x2EB8B896, 0x800A0A8A, 0x679999FE, 0xC92B2BE2, 0x618181E0,
+    0xC30303C0, 0x29A4A48D, 0x238C8CAF, 0xA9AEAE07, 0x0D343439, 0x524D4D1F, 0x4F393976, 0x6EBDBDD3,
+    0xD6575781, 0xD86F6FB7, 0x37DCDCEB, 0x44151551, 0xDD7B7BA6, 0xFEF7F709, 0x8C3A3AB6, 0x2FBCBC93,
+    0x030C0C0F, 0xFCFFFF03, 0x6BA9A9C2, 0x73C9C9BA, 0x6CB5B5D9, 0x6DB1B1DC, 0x5A6D6D37, 0x50454515,
+    0x8F3636B9, 0x1B6C6C77, 0xADBEBE13, 0x904A4ADA, 0xB9EEEE57, 0xDE7777A9, 0xBEF2F24C, 0x7EFDFD83,
+    0x11444455, 0xDA6767BD, 0x5D71712C, 0x40050545, 0x1F7C7C63, 0x10404050, 0x5B696932, 0xDB6363B8,
+    0x0A282822, 0xC20707C5, 0x31C4C4F5, 0x8A2222A8, 0xA7969631, 0xCE3737F9, 0x7AEDED97, 0xBFF6F649,
+    0x2DB4B499, 0x75D1D1A4, 0xD3434390, 0x1248485A, 0xBAE2E258, 0xE6979771, 0xB6D2D264, 0xB2C2C270,
+    0x8B2626AD, 0x68A5A5CD, 0x955E5ECB, 0x4B292962, 0x0C30303C, 0x945A5ACE, 0x76DDDDAB, 0x7FF9F986,
+    0x649595F1, 0xBBE6E65D, 0xF2C7C735, 0x0924242D, 0xC61717D1, 0x6FB9B9D6, 0xC51B1BDE, 0x86121294,
+    0x18606078, 0xF3C3C330, 0x7CF5F589, 0xEFB3B35C, 0x3AE8E8D2, 0xDF7373AC, 0x4C353579, 0x208080A0,
+    0x78E5E59D, 0xEDBBBB56, 0x5E7D7D23, 0x3EF8F8C6, 0xD45F5F8B, 0xC82F2FE7, 0x39E4E4DD, 0x49212168
 };
+#endif
 
+static inline uint32_t load_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static inline void store_be32(uint8_t *p, uint32_t v) {
+    p[0] = (v >> 24) & 0xFF;
+    p[1] = (v >> 16) & 0xFF;
+    p[2] = (v >> 8) & 0xFF;
+    p[3] = v & 0xFF;
+}
+
+// S盒变换 τ：对32位字进行逐字节S盒替换
 uint32_t sbox_transform(uint32_t word) {
     uint32_t result = 0;
     for (int i = 0; i < 4; ++i) {
         uint8_t byte = (word >> (i * 8)) & 0xFF;
-        result |= Sbox[byte] << (i * 8);
+        result |= (uint32_t)Sbox[byte] << (i * 8);
     }
     return result;
 }
 
-uint32_t t_table_transform(uint32_t x0, uint32_t x1, uint32_t x2, uint32_t x3) {
-    uint32_t y0 = sbox_transform(x0);
-    uint32_t y1 = sbox_transform(x1);
-    uint32_t y2 = sbox_transform(x2);
-    uint32_t y3 = sbox_transform(x3);
+// 轮函数合成置换 T(x) = L(τ(x))，L(B) = B ^ (B<<<2) ^ (B<<<10) ^ (B<<<18) ^ (B<<<24)
+static inline uint32_t sm4_t(uint32_t x) {
+    uint32_t b = sbox_transform(x);
+    return b ^ ROTL32(b, 2) ^ ROTL32(b, 10) ^ ROTL32(b, 18) ^ ROTL32(b, 24);
+}
 
-    // 线性混合 + 轮密钥加
-    uint32_t z0 = y0 ^ y1 ^ y2 ^ y3 ^ FK[0];
-    uint32_t z1 = y1 ^ y2 ^ y3 ^ z0 ^ FK[1];
-    uint32_t z2 = y2 ^ y3 ^ z0 ^ z1 ^ FK[2];
-    uint32_t z3 = y3 ^ z0 ^ z1 ^ z2 ^ FK[3];
+// 查表版合成置换：每个字节一次查表，S 盒与 L 已预先合并
+static inline uint32_t sm4_t_table(uint32_t x) {
+#ifdef SM4_SMALL_TTABLE
+    return SM4_T0[x >> 24] ^
+           ROTL32(SM4_T0[(x >> 16) & 0xFF], 24) ^
+           ROTL32(SM4_T0[(x >> 8) & 0xFF], 16) ^
+           ROTL32(SM4_T0[x & 0xFF], 8);
+#else
+    return SM4_T0[x >> 24] ^ SM4_T1[(x >> 16) & 0xFF] ^
+           SM4_T2[(x >> 8) & 0xFF] ^ SM4_T3[x & 0xFF];
+#endif
+}
 
-    return z0 ^ z1 ^ z2 ^ z3; 
+// 密钥扩展合成置换 T'(x) = L'(τ(x))，L'(B) = B ^ (B<<<13) ^ (B<<<23)
+static inline uint32_t sm4_t_key(uint32_t x) {
+    uint32_t b = sbox_transform(x);
+    return b ^ ROTL32(b, 13) ^ ROTL32(b, 23);
 }
 
-// 执行 32 轮加密（模拟 SM4 轮函数）
-void sm4_encrypt_rounds(uint32_t *state, const uint32_t *sk) {
-    for (int i = 0; i < 32; ++i) {
-        state[0] ^= sk[i];  
+// 执行 32 轮迭代并做反序变换 R，state 为 4 个大端字
+void sm4_encrypt_rounds(uint32_t *state, const uint32_t *rk) {
+    uint32_t x0 = state[0], x1 = state[1], x2 = state[2], x3 = state[3];
 
-        // 使用 T 表变换更新其他状态字
-        state[1] = t_table_transform(state[1], state[2], state[3], state[0]);
-        state[2] ^= state[1];
-        state[3] = t_table_transform(state[3], state[0], state[1], state[2]);
-        state[0] ^= state[3];
+    // 每 4 轮一组，避免逐轮搬移状态字
+    for (int i = 0; i < 32; i += 4) {
+        x0 ^= sm4_t(x1 ^ x2 ^ x3 ^ rk[i]);
+        x1 ^= sm4_t(x2 ^ x3 ^ x0 ^ rk[i + 1]);
+        x2 ^= sm4_t(x3 ^ x0 ^ x1 ^ rk[i + 2]);
+        x3 ^= sm4_t(x0 ^ x1 ^ x2 ^ rk[i + 3]);
+    }
 
-        // 每两轮交换 state[1] 和 state[2]（模拟扩散）
-        if (i % 2 == 0) {
-            uint32_t temp = state[1];
-            state[1] = state[2];
-            state[2] = temp;
-        }
+    state[0] = x3;
+    state[1] = x2;
+    state[2] = x1;
+    state[3] = x0;
+}
+
+// 查表版 32 轮迭代，与 sm4_encrypt_rounds 结果一致
+void sm4_ttable_rounds(uint32_t *state, const uint32_t *rk) {
+    uint32_t x0 = state[0], x1 = state[1], x2 = state[2], x3 = state[3];
+
+    for (int i = 0; i < 32; i += 4) {
+        x0 ^= sm4_t_table(x1 ^ x2 ^ x3 ^ rk[i]);
+        x1 ^= sm4_t_table(x2 ^ x3 ^ x0 ^ rk[i + 1]);
+        x2 ^= sm4_t_table(x3 ^ x0 ^ x1 ^ rk[i + 2]);
+        x3 ^= sm4_t_table(x0 ^ x1 ^ x2 ^ rk[i + 3]);
     }
 
-    state[0] ^= sk[32];
-    state[1] ^= sk[33];
-    state[2] ^= sk[34];
-    state[3] ^= sk[35];  
+    state[0] = x3;
+    state[1] = x2;
+    state[2] = x1;
+    state[3] = x0;
 }
 
-// 密钥扩展（占位符）：从 128 位密钥生成 36 个轮密钥
+// 密钥扩展：K_i = MK_i ^ FK_i，rk_i = K_{i+4} = K_i ^ T'(K_{i+1} ^ K_{i+2} ^ K_{i+3} ^ CK_i)
 void sm4_key_schedule(const uint8_t *key, uint32_t *rk) {
-    for (int i = 0; i < 36; ++i) {
-        rk[i] = (key[(i*4)%16] << 24) | (key[(i*4+1)%16] << 16) |
-                (key[(i*4+2)%16] << 8) | key[(i*4+3)%16];
+    uint32_t k0 = load_be32(key) ^ FK[0];
+    uint32_t k1 = load_be32(key + 4) ^ FK[1];
+    uint32_t k2 = load_be32(key + 8) ^ FK[2];
+    uint32_t k3 = load_be32(key + 12) ^ FK[3];
+
+    for (int i = 0; i < 32; i += 4) {
+        rk[i] = k0 ^= sm4_t_key(k1 ^ k2 ^ k3 ^ CK[i]);
+        rk[i + 1] = k1 ^= sm4_t_key(k2 ^ k3 ^ k0 ^ CK[i + 1]);
+        rk[i + 2] = k2 ^= sm4_t_key(k3 ^ k0 ^ k1 ^ CK[i + 2]);
+        rk[i + 3] = k3 ^= sm4_t_key(k0 ^ k1 ^ k2 ^ CK[i + 3]);
     }
 }
 
-// SM4 加密主函数
+void sm4_set_encrypt_key(sm4_ctx *ctx, const uint8_t key[BLOCK_SIZE]) {
+    sm4_key_schedule(key, ctx->rk);
+}
+
+// 解密与加密结构相同，只是轮密钥逆序使用
+void sm4_set_decrypt_key(sm4_ctx *ctx, const uint8_t key[BLOCK_SIZE]) {
+    uint32_t rk[32];
+    sm4_key_schedule(key, rk);
+    for (int i = 0; i < 32; ++i) {
+        ctx->rk[i] = rk[31 - i];
+    }
+}
+
+void sm4_encrypt_block(const sm4_ctx *ctx, const uint8_t in[BLOCK_SIZE], uint8_t out[BLOCK_SIZE]) {
+    uint32_t state[4];
+
+    // 将输入（16 字节）加载为 4 个大端 32 位字
+    for (int i = 0; i < 4; ++i) {
+        state[i] = load_be32(in + i * 4);
+    }
+
+    sm4_ttable_rounds(state, ctx->rk);
+
+    // 将结果写回（大端格式）
+    for (int i = 0; i < 4; ++i) {
+        store_be32(out + i * 4, state[i]);
+    }
+}
+
+// SM4 加密主函数（一次性接口）
 void sm4_encrypt(const uint8_t *plaintext, const uint8_t *key, uint8_t *ciphertext) {
-    uint32_t state[4];  
-    uint32_t rk[36];    
+    sm4_ctx ctx;
+    sm4_set_encrypt_key(&ctx, key);
+    sm4_encrypt_block(&ctx, plaintext, ciphertext);
+}
+
+// ====================== 多分组后端 ======================
+
+// 标量后端：逐个分组调用轮函数
+static void sm4_ref_blocks(const uint32_t *rk, const uint8_t *in, uint8_t *out, size_t nblocks) {
+    for (size_t i = 0; i < nblocks; ++i, in += BLOCK_SIZE, out += BLOCK_SIZE) {
+        uint32_t state[4];
+        for (int j = 0; j < 4; ++j) {
+            state[j] = load_be32(in + j * 4);
+        }
+        sm4_encrypt_rounds(state, rk);
+        for (int j = 0; j < 4; ++j) {
+            store_be32(out + j * 4, state[j]);
+        }
+    }
+}
+
+static void sm4_ttable_blocks(const uint32_t *rk, const uint8_t *in, uint8_t *out, size_t nblocks) {
+    for (size_t i = 0; i < nblocks; ++i, in += BLOCK_SIZE, out += BLOCK_SIZE) {
+        uint32_t state[4];
+        for (int j = 0; j < 4; ++j) {
+            state[j] = load_be32(in + j * 4);
+        }
+        sm4_ttable_rounds(state, rk);
+        for (int j = 0; j < 4; ++j) {
+            store_be32(out + j * 4, state[j]);
+        }
+    }
+}
+
+// CTR（32 位计数器）的通用实现：在缓冲区中按批生成计数器分组，交给 blocks 加密后与输入异或。
+// iv[0..2] 为计数器分组前 12 字节，iv[3] 为当前计数器，返回时已前进 nblocks
+#define SM4_CTR_BATCH 16
+
+static inline void sm4_ctr32_generic(void (*blocks)(const uint32_t *, const uint8_t *, uint8_t *, size_t),
+                                     size_t batch, uint8_t *buf, const uint32_t *rk,
+                                     const uint8_t *in, uint8_t *out, size_t nblocks, uint32_t iv[4]) {
+    while (nblocks > 0) {
+        size_t n = nblocks < batch ? nblocks : batch;
+        for (size_t k = 0; k < n; ++k) {
+            store_be32(buf + k * BLOCK_SIZE, iv[0]);
+            store_be32(buf + k * BLOCK_SIZE + 4, iv[1]);
+            store_be32(buf + k * BLOCK_SIZE + 8, iv[2]);
+            store_be32(buf + k * BLOCK_SIZE + 12, iv[3]++);
+        }
+        blocks(rk, buf, buf, n);
+        for (size_t j = 0; j < n * BLOCK_SIZE; ++j) {
+            out[j] = in[j] ^ buf[j];
+        }
+        in += n * BLOCK_SIZE;
+        out += n * BLOCK_SIZE;
+        nblocks -= n;
+    }
+}
+
+static void sm4_ref_ctr32(const uint32_t *rk, const uint8_t *in, uint8_t *out, size_t nblocks, uint32_t iv[4]) {
+    uint8_t buf[SM4_CTR_BATCH * BLOCK_SIZE];
+    sm4_ctr32_generic(sm4_ref_blocks, SM4_CTR_BATCH, buf, rk, in, out, nblocks, iv);
+}
+
+static void sm4_ttable_ctr32(const uint32_t *rk, const uint8_t *in, uint8_t *out, size_t nblocks, uint32_t iv[4]) {
+    uint8_t buf[SM4_CTR_BATCH * BLOCK_SIZE];
+    sm4_ctr32_generic(sm4_ttable_blocks, SM4_CTR_BATCH, buf, rk, in, out, nblocks, iv);
+}
+
+// 多密钥的通用实现：使用同一密钥的相邻分组合并为一次 blocks 调用
+static void sm4_multi_runs(void (*blocks)(const uint32_t *, const uint8_t *, uint8_t *, size_t),
+                           const sm4_ctx *const ctxs[], const uint8_t *in, uint8_t *out, size_t nblocks) {
+    size_t i = 0;
+    while (i < nblocks) {
+        size_t j = i + 1;
+        while (j < nblocks && ctxs[j] == ctxs[i]) {
+            ++j;
+        }
+        blocks(ctxs[i]->rk, in + i * BLOCK_SIZE, out + i * BLOCK_SIZE, j - i);
+        i = j;
+    }
+}
+
+static inline int sm4_same_ctx(const sm4_ctx *const ctxs[], size_t n) {
+    for (size_t i = 1; i < n; ++i) {
+        if (ctxs[i] != ctxs[0]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+#ifdef SM4_X86
+// AES-NI 计算 SM4 S 盒：两者都是"仿射 ∘ GF(2^8) 求逆 ∘ 仿射"，且两个有限域同构。
+// 先用仿射 f 把输入映射进 AES 的域（同时完成 SM4 的前置仿射），AESENCLAST 完成求逆和 AES 仿射，
+// 最后用仿射 g 抵消 AES 仿射并完成 SM4 的后置仿射。f、g 按低/高 4 比特拆成 16 字节表，用 PSHUFB 查表。
+static const uint8_t sm4_aesni_pre_lo[16] = {
+    0x3E, 0xB2, 0x0E, 0x82, 0xBB, 0x37, 0x8B, 0x07, 0xA1, 0x2D, 0x91, 0x1D, 0x24, 0xA8, 0x14, 0x98
+};
+static const uint8_t sm4_aesni_pre_hi[16] = {
+    0x00, 0xDC, 0x2E, 0xF2, 0xC5, 0x19, 0xEB, 0x37, 0x08, 0xD4, 0x26, 0xFA, 0xCD, 0x11, 0xE3, 0x3F
+};
+static const uint8_t sm4_aesni_post_lo[16] = {
+    0x6C, 0xD4, 0xA6, 0x1E, 0x52, 0xEA, 0x98, 0x20, 0x0B, 0xB3, 0xC1, 0x79, 0x35, 0x8D, 0xFF, 0x47
+};
+static const uint8_t sm4_aesni_post_hi[16] = {
+    0x00, 0xE0, 0x50, 0xB0, 0x9D, 0x7D, 0xCD, 0x2D, 0xC0, 0x20, 0x90, 0x70, 0x5D, 0xBD, 0x0D, 0xED
+};
+
+// AESENCLAST 先做 ShiftRows，预先做一次逆 ShiftRows 使 S 盒结果留在原字节位置
+static const uint8_t sm4_inv_shift_rows[16] = {
+    0x00, 0x0D, 0x0A, 0x07, 0x04, 0x01, 0x0E, 0x0B, 0x08, 0x05, 0x02, 0x0F, 0x0C, 0x09, 0x06, 0x03
+};
+
+// 32 位字内的字节置换：大端装载、循环左移 8/16/24
+static const uint8_t sm4_bswap32[16] = {
+    3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+};
+static const uint8_t sm4_rotl8[16] = {
+    3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14
+};
+static const uint8_t sm4_rotl16[16] = {
+    2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13
+};
+static const uint8_t sm4_rotl24[16] = {
+    1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12
+};
+
+#define SM4_LOAD128(p) _mm_loadu_si128((const __m128i *)(p))
+
+// ---------- SSSE3 + AES-NI：每个 XMM 存 4 个分组的同一个字 ----------
+#define SM4_TARGET_AESNI __attribute__((target("ssse3,aes")))
+
+SM4_TARGET_AESNI
+static inline __m128i sm4_aesni_affine(__m128i x, __m128i lo_tbl, __m128i hi_tbl) {
+    __m128i mask = _mm_set1_epi8(0x0F);
+    __m128i lo = _mm_and_si128(x, mask);
+    __m128i hi = _mm_and_si128(_mm_srli_epi32(x, 4), mask);
+    return _mm_xor_si128(_mm_shuffle_epi8(lo_tbl, lo), _mm_shuffle_epi8(hi_tbl, hi));
+}
+
+SM4_TARGET_AESNI
+static inline __m128i sm4_aesni_t(__m128i x) {
+    x = sm4_aesni_affine(x, SM4_LOAD128(sm4_aesni_pre_lo), SM4_LOAD128(sm4_aesni_pre_hi));
+    x = _mm_shuffle_epi8(x, SM4_LOAD128(sm4_inv_shift_rows));
+    x = _mm_aesenclast_si128(x, _mm_setzero_si128());
+    x = sm4_aesni_affine(x, SM4_LOAD128(sm4_aesni_post_lo), SM4_LOAD128(sm4_aesni_post_hi));
+
+    // L(B) = B ^ (B<<<24) ^ ((B ^ (B<<<8) ^ (B<<<16)) <<< 2)
+    __m128i t = _mm_xor_si128(x, _mm_xor_si128(_mm_shuffle_epi8(x, SM4_LOAD128(sm4_rotl8)),
+                                               _mm_shuffle_epi8(x, SM4_LOAD128(sm4_rotl16))));
+    t = _mm_or_si128(_mm_slli_epi32(t, 2), _mm_srli_epi32(t, 30));
+    return _mm_xor_si128(_mm_xor_si128(x, _mm_shuffle_epi8(x, SM4_LOAD128(sm4_rotl24))), t);
+}
+
+// 4x4 字转置：输入 4 个分组，输出 x[i] = 4 个分组的第 i 个字（转置是对合的，存储时同样使用）
+#define SM4_TRANSPOSE4(suffix, x0, x1, x2, x3) do {                  \
+        __typeof__(x0) t0_ = suffix##_unpacklo_epi32(x0, x1);        \
+        __typeof__(x0) t1_ = suffix##_unpacklo_epi32(x2, x3);        \
+        __typeof__(x0) t2_ = suffix##_unpackhi_epi32(x0, x1);        \
+        __typeof__(x0) t3_ = suffix##_unpackhi_epi32(x2, x3);        \
+        x0 = suffix##_unpacklo_epi64(t0_, t1_);                      \
+        x1 = suffix##_unpackhi_epi64(t0_, t1_);                      \
+        x2 = suffix##_unpacklo_epi64(t2_, t3_);                      \
+        x3 = suffix##_unpackhi_epi64(t2_, t3_);                      \
+    } while (0)
+
+SM4_TARGET_AESNI
+static inline void sm4_aesni_rounds4(const uint32_t *rk, __m128i x[4]) {
+    for (int i = 0; i < 32; i += 4) {
+        x[0] = _mm_xor_si128(x[0], sm4_aesni_t(_mm_xor_si128(_mm_xor_si128(x[1], x[2]),
+                                                             _mm_xor_si128(x[3], _mm_set1_epi32(rk[i])))));
+        x[1] = _mm_xor_si128(x[1], sm4_aesni_t(_mm_xor_si128(_mm_xor_si128(x[2], x[3]),
+                                                             _mm_xor_si128(x[0], _mm_set1_epi32(rk[i + 1])))));
+        x[2] = _mm_xor_si128(x[2], sm4_aesni_t(_mm_xor_si128(_mm_xor_si128(x[3], x[0]),
+                                                             _mm_xor_si128(x[1], _mm_set1_epi32(rk[i + 2])))));
+        x[3] = _mm_xor_si128(x[3], sm4_aesni_t(_mm_xor_si128(_mm_xor_si128(x[0], x[1]),
+                                                             _mm_xor_si128(x[2], _mm_set1_epi32(rk[i + 3])))));
+    }
+}
+
+// 反序变换 R：输出 (X35, X34, X33, X32)；xor_in 非空时与其异或后写出（CTR）
+SM4_TARGET_AESNI
+static inline void sm4_aesni_store4(uint8_t *out, __m128i x[4], const uint8_t *xor_in) {
+    __m128i bswap = SM4_LOAD128(sm4_bswap32);
+    SM4_TRANSPOSE4(_mm, x[3], x[2], x[1], x[0]);
+    for (int k = 0; k < 4; k++) {
+        __m128i v = _mm_shuffle_epi8(x[3 - k], bswap);
+        if (xor_in != NULL) {
+            v = _mm_xor_si128(v, SM4_LOAD128(xor_in + 16 * k));
+        }
+        _mm_storeu_si128((__m128i *)(out + 16 * k), v);
+    }
+}
+
+SM4_TARGET_AESNI
+static void sm4_aesni_encrypt4(const uint32_t *rk, const uint8_t *in, uint8_t *out) {
+    __m128i bswap = SM4_LOAD128(sm4_bswap32);
+    __m128i x[4];
+    for (int k = 0; k < 4; k++) {
+        x[k] = _mm_shuffle_epi8(SM4_LOAD128(in + 16 * k), bswap);
+    }
+    SM4_TRANSPOSE4(_mm, x[0], x[1], x[2], x[3]);
+
+    sm4_aesni_rounds4(rk, x);
+    sm4_aesni_store4(out, x, NULL);
+}
+
+// CTR：计数器分组直接在转置后的寄存器中构造，x[0..2] 为 IV 前 3 个字的广播，x[3] 为各分组的计数器
+SM4_TARGET_AESNI
+static void sm4_aesni_ctr32_4(const uint32_t *rk, const uint32_t iv[4], const uint8_t *in, uint8_t *out) {
+    __m128i x[4];
+    x[0] = _mm_set1_epi32(iv[0]);
+    x[1] = _mm_set1_epi32(iv[1]);
+    x[2] = _mm_set1_epi32(iv[2]);
+    x[3] = _mm_add_epi32(_mm_set1_epi32(iv[3]), _mm_setr_epi32(0, 1, 2, 3));
+
+    sm4_aesni_rounds4(rk, x);
+    sm4_aesni_store4(out, x, in);
+}
+
+static void sm4_aesni_blocks(const uint32_t *rk, const uint8_t *in, uint8_t *out, size_t nblocks) {
+    for (; nblocks >= 4; nblocks -= 4, in += 4 * BLOCK_SIZE, out += 4 * BLOCK_SIZE) {
+        sm4_aesni_encrypt4(rk, in, out);
+    }
+    sm4_ttable_blocks(rk, in, out, nblocks);
+}
+
+static void sm4_aesni_ctr32(const uint32_t *rk, const uint8_t *in, uint8_t *out, size_t nblocks, uint32_t iv[4]) {
+    for (; nblocks >= 4; nblocks -= 4, in += 4 * BLOCK_SIZE, out += 4 * BLOCK_SIZE) {
+        sm4_aesni_ctr32_4(rk, iv, in, out);
+        iv[3] += 4;
+    }
+    sm4_ttable_ctr32(rk, in, out, nblocks, iv);
+}
+
+// ---------- AVX2 + AES-NI：每个 YMM 存 8 个分组，AESENCLAST 分两个 128 位半边执行 ----------
+#define SM4_TARGET_AVX2 __attribute__((target("avx2,aes")))
+
+SM4_TARGET_AVX2
+static inline __m256i sm4_avx2_affine(__m256i x, __m256i lo_tbl, __m256i hi_tbl) {
+    __m256i mask = _mm256_set1_epi8(0x0F);
+    __m256i lo = _mm256_and_si256(x, mask);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi32(x, 4), mask);
+    return _mm256_xor_si256(_mm256_shuffle_epi8(lo_tbl, lo), _mm256_shuffle_epi8(hi_tbl, hi));
+}
+
+#define SM4_BCAST256(p) _mm256_broadcastsi128_si256(SM4_LOAD128(p))
+
+SM4_TARGET_AVX2
+static inline __m256i sm4_avx2_t(__m256i x) {
+    x = sm4_avx2_affine(x, SM4_BCAST256(sm4_aesni_pre_lo), SM4_BCAST256(sm4_aesni_pre_hi));
+    x = _mm256_shuffle_epi8(x, SM4_BCAST256(sm4_inv_shift_rows));
+    __m128i lo = _mm_aesenclast_si128(_mm256_castsi256_si128(x), _mm_setzero_si128());
+    __m128i hi = _mm_aesenclast_si128(_mm256_extracti128_si256(x, 1), _mm_setzero_si128());
+    x = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+    x = sm4_avx2_affine(x, SM4_BCAST256(sm4_aesni_post_lo), SM4_BCAST256(sm4_aesni_post_hi));
+
+    __m256i t = _mm256_xor_si256(x, _mm256_xor_si256(_mm256_shuffle_epi8(x, SM4_BCAST256(sm4_rotl8)),
+                                                     _mm256_shuffle_epi8(x, SM4_BCAST256(sm4_rotl16))));
+    t = _mm256_or_si256(_mm256_slli_epi32(t, 2), _mm256_srli_epi32(t, 30));
+    return _mm256_xor_si256(_mm256_xor_si256(x, _mm256_shuffle_epi8(x, SM4_BCAST256(sm4_rotl24))), t);
+}
+
+SM4_TARGET_AVX2
+static inline void sm4_avx2_rounds8(const uint32_t *rk, __m256i x[4]) {
+    for (int i = 0; i < 32; i += 4) {
+        x[0] = _mm256_xor_si256(x[0], sm4_avx2_t(_mm256_xor_si256(_mm256_xor_si256(x[1], x[2]),
+                                                                  _mm256_xor_si256(x[3], _mm256_set1_epi32(rk[i])))));
+        x[1] = _mm256_xor_si256(x[1], sm4_avx2_t(_mm256_xor_si256(_mm256_xor_si256(x[2], x[3]),
+                                                                  _mm256_xor_si256(x[0], _mm256_set1_epi32(rk[i + 1])))));
+        x[2] = _mm256_xor_si256(x[2], sm4_avx2_t(_mm256_xor_si256(_mm256_xor_si256(x[3], x[0]),
+                                                                  _mm256_xor_si256(x[1], _mm256_set1_epi32(rk[i + 2])))));
+        x[3] = _mm256_xor_si256(x[3], sm4_avx2_t(_mm256_xor_si256(_mm256_xor_si256(x[0], x[1]),
+                                                                  _mm256_xor_si256(x[2], _mm256_set1_epi32(rk[i + 3])))));
+    }
+}
+
+SM4_TARGET_AVX2
+static inline void sm4_avx2_store8(uint8_t *out, __m256i x[4], const uint8_t *xor_in) {
+    __m256i bswap = SM4_BCAST256(sm4_bswap32);
+    SM4_TRANSPOSE4(_mm256, x[3], x[2], x[1], x[0]);
+    for (int k = 0; k < 4; k++) {
+        __m256i v = _mm256_shuffle_epi8(x[3 - k], bswap);
+        if (xor_in != NULL) {
+            v = _mm256_xor_si256(v, _mm256_loadu_si256((const __m256i *)(xor_in + 32 * k)));
+        }
+        _mm256_storeu_si256((__m256i *)(out + 32 * k), v);
+    }
+}
+
+// 每个 YMM 装载相邻两个分组，128 位半边内转置后，x[i] 的两个半边分别是分组 {0,2,4,6} 与 {1,3,5,7} 的第 i 个字
+SM4_TARGET_AVX2
+static void sm4_avx2_encrypt8(const uint32_t *rk, const uint8_t *in, uint8_t *out) {
+    __m256i bswap = SM4_BCAST256(sm4_bswap32);
+    __m256i x[4];
+    for (int k = 0; k < 4; k++) {
+        x[k] = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *)(in + 32 * k)), bswap);
+    }
+    SM4_TRANSPOSE4(_mm256, x[0], x[1], x[2], x[3]);
+
+    sm4_avx2_rounds8(rk, x);
+    sm4_avx2_store8(out, x, NULL);
+}
+
+// 与上面的布局一致：半边 j 的第 k 个字属于分组 2k + j
+SM4_TARGET_AVX2
+static void sm4_avx2_ctr32_8(const uint32_t *rk, const uint32_t iv[4], const uint8_t *in, uint8_t *out) {
+    __m256i x[4];
+    x[0] = _mm256_set1_epi32(iv[0]);
+    x[1] = _mm256_set1_epi32(iv[1]);
+    x[2] = _mm256_set1_epi32(iv[2]);
+    x[3] = _mm256_add_epi32(_mm256_set1_epi32(iv[3]), _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7));
+
+    sm4_avx2_rounds8(rk, x);
+    sm4_avx2_store8(out, x, in);
+}
+
+static void sm4_avx2_blocks(const uint32_t *rk, const uint8_t *in, uint8_t *out, size_t nblocks) {
+    for (; nblocks >= 8; nblocks -= 8, in += 8 * BLOCK_SIZE, out += 8 * BLOCK_SIZE) {
+        sm4_avx2_encrypt8(rk, in, out);
+    }
+    sm4_aesni_blocks(rk, in, out, nblocks);
+}
+
+static void sm4_avx2_ctr32(const uint32_t *rk, const uint8_t *in, uint8_t *out, size_t nblocks, uint32_t iv[4]) {
+    for (; nblocks >= 8; nblocks -= 8, in += 8 * BLOCK_SIZE, out += 8 * BLOCK_SIZE) {
+        sm4_avx2_ctr32_8(rk, iv, in, out);
+        iv[3] += 8;
+    }
+    sm4_aesni_ctr32(rk, in, out, nblocks, iv);
+}
+
+// ---------- AVX-512 + VAES：每个 ZMM 存 16 个分组，VPROLD 完成 L 中的循环移位 ----------
+#define SM4_TARGET_AVX512 __attribute__((target("avx512f,avx512bw,vaes")))
+// VAES 与 GFNI 内核共用的装载/存储/线性变换只需要 AVX-512BW；目标特性不多于调用者才能被内联
+#define SM4_TARGET_AVX512BW __attribute__((target("avx512f,avx512bw")))
+
+SM4_TARGET_AVX512BW
+static inline __m512i sm4_avx512_affine(__m512i x, __m512i lo_tbl, __m512i hi_tbl) {
+    __m512i mask = _mm512_set1_epi8(0x0F);
+    __m512i lo = _mm512_and_si512(x, mask);
+    __m512i hi = _mm512_and_si512(_mm512_srli_epi32(x, 4), mask);
+    return _mm512_xor_si512(_mm512_shuffle_epi8(lo_tbl, lo), _mm512_shuffle_epi8(hi_tbl, hi));
+}
+
+#define SM4_BCAST512(p) _mm512_broadcast_i32x4(SM4_LOAD128(p))
+
+// 三输入异或：VPTERNLOGD 真值表 0x96
+#define SM4_XOR3_512(a, b, c) _mm512_ternarylogic_epi32(a, b, c, 0x96)
+
+SM4_TARGET_AVX512BW
+static inline __m512i sm4_avx512_l(__m512i x) {
+    return SM4_XOR3_512(SM4_XOR3_512(x, _mm512_rol_epi32(x, 2), _mm512_rol_epi32(x, 10)),
+                        _mm512_rol_epi32(x, 18), _mm512_rol_epi32(x, 24));
+}
+
+SM4_TARGET_AVX512
+static inline __m512i sm4_vaes_t(__m512i x) {
+    x = sm4_avx512_affine(x, SM4_BCAST512(sm4_aesni_pre_lo), SM4_BCAST512(sm4_aesni_pre_hi));
+    x = _mm512_shuffle_epi8(x, SM4_BCAST512(sm4_inv_shift_rows));
+    x = _mm512_aesenclast_epi128(x, _mm512_setzero_si512());
+    x = sm4_avx512_affine(x, SM4_BCAST512(sm4_aesni_post_lo), SM4_BCAST512(sm4_aesni_post_hi));
+    return sm4_avx512_l(x);
+}
+
+// 16 个分组装载为 4 个 ZMM：每个 ZMM 装载相邻 4 个分组，128 位通道内转置后 x[i] 为第 i 个状态字
+SM4_TARGET_AVX512BW
+static inline void sm4_avx512_load16(const uint8_t *in, __m512i x[4]) {
+    __m512i bswap = SM4_BCAST512(sm4_bswap32);
+    x[0] = _mm512_shuffle_epi8(_mm512_loadu_si512(in), bswap);
+    x[1] = _mm512_shuffle_epi8(_mm512_loadu_si512(in + 64), bswap);
+    x[2] = _mm512_shuffle_epi8(_mm512_loadu_si512(in + 128), bswap);
+    x[3] = _mm512_shuffle_epi8(_mm512_loadu_si512(in + 192), bswap);
+    SM4_TRANSPOSE4(_mm512, x[0], x[1], x[2], x[3]);
+}
+
+// 反序变换 R 后转置回分组顺序并写出，xor_in 非空时先与其异或（CTR）
+SM4_TARGET_AVX512BW
+static inline void sm4_avx512_store16(uint8_t *out, __m512i x[4], const uint8_t *xor_in) {
+    __m512i bswap = SM4_BCAST512(sm4_bswap32);
+    SM4_TRANSPOSE4(_mm512, x[3], x[2], x[1], x[0]);
+    for (int k = 0; k < 4; k++) {
+        __m512i v = _mm512_shuffle_epi8(x[3 - k], bswap);
+        if (xor_in != NULL) {
+            v = _mm512_xor_si512(v, _mm512_loadu_si512(xor_in + 64 * k));
+        }
+        _mm512_storeu_si512(out + 64 * k, v);
+    }
+}
+
+// 32 轮：RK(i) 给出第 i 轮的轮密钥向量
+#define SM4_AVX512_ROUNDS(T, x, RK) do {                                                                  \
+        for (int i = 0; i < 32; i += 4) {                                                                 \
+            x[0] = _mm512_xor_si512(x[0], T(SM4_XOR3_512(x[1], x[2], _mm512_xor_si512(x[3], RK(i)))));     \
+            x[1] = _mm512_xor_si512(x[1], T(SM4_XOR3_512(x[2], x[3], _mm512_xor_si512(x[0], RK(i + 1))))); \
+            x[2] = _mm512_xor_si512(x[2], T(SM4_XOR3_512(x[3], x[0], _mm512_xor_si512(x[1], RK(i + 2))))); \
+            x[3] = _mm512_xor_si512(x[3], T(SM4_XOR3_512(x[0], x[1], _mm512_xor_si512(x[2], RK(i + 3))))); \
+        }                                                                                                 \
+    } while (0)
+#define SM4_RK_BCAST512(i) _mm512_set1_epi32(rk[i])
+#define SM4_RK_VEC512(i) rkv[i]
+
+// 多密钥时按转置布局收集轮密钥：元素 e（通道 e / 4，第 e % 4 个字）属于分组 4·(e % 4) + e / 4。
+// 16 个分组通常只来自少数几个包，先按密钥分组得到掩码，每轮每个密钥一条带掩码的广播
+SM4_TARGET_AVX512BW
+static inline void sm4_avx512_gather_rk(const sm4_ctx *const ctxs[16], __m512i rkv[32]) {
+    const sm4_ctx *uniq[16];
+    __mmask16 masks[16];
+    int nu = 0;
+    for (int e = 0; e < 16; e++) {
+        const sm4_ctx *c = ctxs[4 * (e & 3) + (e >> 2)];
+        int u = 0;
+        while (u < nu && uniq[u] != c) {
+            u++;
+        }
+        if (u == nu) {
+            uniq[nu] = c;
+            masks[nu++] = 0;
+        }
+        masks[u] |= (__mmask16)(1u << e);
+    }
+
+    for (int i = 0; i < 32; i++) {
+        __m512i v = _mm512_set1_epi32(uniq[0]->rk[i]);
+        for (int u = 1; u < nu; u++) {
+            v = _mm512_mask_set1_epi32(v, masks[u], uniq[u]->rk[i]);
+        }
+        rkv[i] = v;
+    }
+}
+
+// CTR 计数器直接以转置布局构造：通道 j 的第 k 个字属于分组 4k + j
+SM4_TARGET_AVX512BW
+static inline void sm4_avx512_ctr16(const uint32_t iv[4], __m512i x[4]) {
+    x[0] = _mm512_set1_epi32(iv[0]);
+    x[1] = _mm512_set1_epi32(iv[1]);
+    x[2] = _mm512_set1_epi32(iv[2]);
+    x[3] = _mm512_add_epi32(_mm512_set1_epi32(iv[3]),
+                            _mm512_setr_epi32(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15));
+}
+
+SM4_TARGET_AVX512
+static inline void sm4_vaes_rounds16(const uint32_t *rk, __m512i x[4]) {
+    SM4_AVX512_ROUNDS(sm4_vaes_t, x, SM4_RK_BCAST512);
+}
+
+// 多密钥：每个通道使用各自的轮密钥
+SM4_TARGET_AVX512
+static inline void sm4_vaes_rounds16_mk(const __m512i rkv[32], __m512i x[4]) {
+    SM4_AVX512_ROUNDS(sm4_vaes_t, x, SM4_RK_VEC512);
+}
+
+SM4_TARGET_AVX512
+static void sm4_vaes_encrypt16(const uint32_t *rk, const uint8_t *in, uint8_t *out) {
+    __m512i x[4];
+    sm4_avx512_load16(in, x);
+    sm4_vaes_rounds16(rk, x);
+    sm4_avx512_store16(out, x, NULL);
+}
+
+SM4_TARGET_AVX512
+static void sm4_vaes_ctr32_16(const uint32_t *rk, const uint32_t iv[4], const uint8_t *in, uint8_t *out) {
+    __m512i x[4];
+    sm4_avx512_ctr16(iv, x);
+    sm4_vaes_rounds16(rk, x);
+    sm4_avx512_store16(out, x, in);
+}
+
+SM4_TARGET_AVX512
+static void sm4_vaes_encrypt16_mk(const sm4_ctx *const ctxs[16], const uint8_t *in, uint8_t *out) {
+    __m512i x[4], rkv[32];
+    sm4_avx512_gather_rk(ctxs, rkv);
+    sm4_avx512_load16(in, x);
+    sm4_vaes_rounds16_mk(rkv, x);
+    sm4_avx512_store16(out, x, NULL);
+}
+
+static void sm4_vaes_blocks(const uint32_t *rk, const uint8_t *in, uint8_t *out, size_t nblocks) {
+    for (; nblocks >= 16; nblocks -= 16, in += 16 * BLOCK_SIZE, out += 16 * BLOCK_SIZE) {
+        sm4_vaes_encrypt16(rk, in, out);
+    }
+    sm4_avx2_blocks(rk, in, out, nblocks);
+}
+
+static void sm4_vaes_ctr32(const uint32_t *rk, const uint8_t *in, uint8_t *out, size_t nblocks, uint32_t iv[4]) {
+    for (; nblocks >= 16; nblocks -= 16, in += 16 * BLOCK_SIZE, out += 16 * BLOCK_SIZE) {
+        sm4_vaes_ctr32_16(rk, iv, in, out);
+        iv[3] += 16;
+    }
+    sm4_avx2_ctr32(rk, in, out, nblocks, iv);
+}
+
+static void sm4_vaes_multi(const sm4_ctx *const ctxs[], const uint8_t *in, uint8_t *out, size_t nblocks) {
+    for (; nblocks >= 16; nblocks -= 16, ctxs += 16, in += 16 * BLOCK_SIZE, out += 16 * BLOCK_SIZE) {
+        if (sm4_same_ctx(ctxs, 16)) {
+            sm4_vaes_encrypt16(ctxs[0]->rk, in, out);
+        } else {
+            sm4_vaes_encrypt16_mk(ctxs, in, out);
+        }
+    }
+
+    // 尾部补齐到 16 个通道，避免混合密钥的短段逐级退化到标量实现
+    if (nblocks > 0) {
+        uint8_t buf[16 * BLOCK_SIZE];
+        const sm4_ctx *pad[16];
+        for (size_t i = 0; i < 16; ++i) {
+            pad[i] = ctxs[i < nblocks ? i : nblocks - 1];
+        }
+        memcpy(buf, in, nblocks * BLOCK_SIZE);
+        sm4_vaes_encrypt16_mk(pad, buf, buf);
+        memcpy(out, buf, nblocks * BLOCK_SIZE);
+    }
+}
+
+// ---------- AVX-512 + GFNI：GF2P8AFFINEQB / GF2P8AFFINEINVQB 直接计算 S 盒，不需要查表 ----------
+// SM4 S(x) = A·inv(A·x + 0xD3) + 0xD3（SM4 多项式 0x1F5 上求逆）。设 φ 为 SM4 域到 AES 域（0x11B）的同构：
+//   前置仿射 y = φ(A·x + 0xD3)，后置 S = (A·φ^-1)·inv_aes(y) + 0xD3，后者恰好是 GF2P8AFFINEINVQB 的形式。
+// 矩阵按指令要求编码：qword 的第 (7 - i) 个字节是输出第 i 位的行
+#define SM4_GFNI_PRE_MATRIX  0x4C287DB91A22505DULL
+#define SM4_GFNI_PRE_CONST   0x3E
+#define SM4_GFNI_POST_MATRIX 0xF3AB34A974A6B589ULL
+#define SM4_GFNI_POST_CONST  0xD3
+
+#define SM4_TARGET_GFNI __attribute__((target("avx512f,avx512bw,gfni")))
+
+SM4_TARGET_GFNI
+static inline __m512i sm4_gfni_t(__m512i x) {
+    x = _mm512_gf2p8affine_epi64_epi8(x, _mm512_set1_epi64(SM4_GFNI_PRE_MATRIX), SM4_GFNI_PRE_CONST);
+    x = _mm512_gf2p8affineinv_epi64_epi8(x, _mm512_set1_epi64(SM4_GFNI_POST_MATRIX), SM4_GFNI_POST_CONST);
+    return sm4_avx512_l(x);
+}
+
+SM4_TARGET_GFNI
+static inline void sm4_gfni_rounds16(const uint32_t *rk, __m512i x[4]) {
+    SM4_AVX512_ROUNDS(sm4_gfni_t, x, SM4_RK_BCAST512);
+}
+
+// 多密钥：每个通道使用各自的轮密钥
+SM4_TARGET_GFNI
+static inline void sm4_gfni_rounds16_mk(const __m512i rkv[32], __m512i x[4]) {
+    SM4_AVX512_ROUNDS(sm4_gfni_t, x, SM4_RK_VEC512);
+}
+
+SM4_TARGET_GFNI
+static void sm4_gfni_encrypt16(const uint32_t *rk, const uint8_t *in, uint8_t *out) {
+    __m512i x[4];
+    sm4_avx512_load16(in, x);
+    sm4_gfni_rounds16(rk, x);
+    sm4_avx512_store16(out, x, NULL);
+}
+
+SM4_TARGET_GFNI
+static void sm4_gfni_ctr32_16(const uint32_t *rk, const uint32_t iv[4], const uint8_t *in, uint8_t *out) {
+    __m512i x[4];
+    sm4_avx512_ctr16(iv, x);
+    sm4_gfni_rounds16(rk, x);
+    sm4_avx512_store16(out, x, in);
+}
+
+SM4_TARGET_GFNI
+static void sm4_gfni_encrypt16_mk(const sm4_ctx *const ctxs[16], const uint8_t *in, uint8_t *out) {
+    __m512i x[4], rkv[32];
+    sm4_avx512_gather_rk(ctxs, rkv);
+    sm4_avx512_load16(in, x);
+    sm4_gfni_rounds16_mk(rkv, x);
+    sm4_avx512_store16(out, x, NULL);
+}
+
+static void sm4_gfni_blocks(const uint32_t *rk, const uint8_t *in, uint8_t *out, size_t nblocks) {
+    for (; nblocks >= 16; nblocks -= 16, in += 16 * BLOCK_SIZE, out += 16 * BLOCK_SIZE) {
+        sm4_gfni_encrypt16(rk, in, out);
+    }
+    sm4_avx2_blocks(rk, in, out, nblocks);
+}
+
+static void sm4_gfni_ctr32(const uint32_t *rk, const uint8_t *in, uint8_t *out, size_t nblocks, uint32_t iv[4]) {
+    for (; nblocks >= 16; nblocks -= 16, in += 16 * BLOCK_SIZE, out += 16 * BLOCK_SIZE) {
+        sm4_gfni_ctr32_16(rk, iv, in, out);
+        iv[3] += 16;
+    }
+    sm4_avx2_ctr32(rk, in, out, nblocks, iv);
+}
+
+static void sm4_gfni_multi(const sm4_ctx *const ctxs[], const uint8_t *in, uint8_t *out, size_t nblocks) {
+    for (; nblocks >= 16; nblocks -= 16, ctxs += 16, in += 16 * BLOCK_SIZE, out += 16 * BLOCK_SIZE) {
+        if (sm4_same_ctx(ctxs, 16)) {
+            sm4_gfni_encrypt16(ctxs[0]->rk, in, out);
+        } else {
+            sm4_gfni_encrypt16_mk(ctxs, in, out);
+        }
+    }
+
+    // 尾部补齐到 16 个通道，避免混合密钥的短段逐级退化到标量实现
+    if (nblocks > 0) {
+        uint8_t buf[16 * BLOCK_SIZE];
+        const sm4_ctx *pad[16];
+        for (size_t i = 0; i < 16; ++i) {
+            pad[i] = ctxs[i < nblocks ? i : nblocks - 1];
+        }
+        memcpy(buf, in, nblocks * BLOCK_SIZE);
+        sm4_gfni_encrypt16_mk(pad, buf, buf);
+        memcpy(out, buf, nblocks * BLOCK_SIZE);
+    }
+}
+
+static int sm4_aesni_supported(void) {
+    return __builtin_cpu_supports("ssse3") && __builtin_cpu_supports("aes");
+}
+
+static int sm4_avx2_supported(void) {
+    return sm4_aesni_supported() && __builtin_cpu_supports("avx2");
+}
+
+static int sm4_vaes_supported(void) {
+    return sm4_avx2_supported() && __builtin_cpu_supports("avx512f") &&
+           __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("vaes");
+}
+
+static int sm4_gfni_supported(void) {
+    return sm4_avx2_supported() && __builtin_cpu_supports("avx512f") &&
+           __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("gfni");
+}
+#endif
+
+// ---------- 比特切片（bitslice）：常数时间，无任何依赖数据的查表或分支 ----------
+// 每次处理 SM4_BS_WIDTH 个分组：状态按比特平面存放，x[w * 32 + b] 的第 k 位是第 k 个分组第 w 个字的第 b 位。
+// 字内循环移位变成平面下标的重新编号，L 只剩异或；S 盒用塔域 GF((2^4)^2) 上的求逆电路实现。
+// SM4_BS_WIDTH 可在编译时取 64/128/256，默认 128（x86-64 上对应 SSE2，256 在 x86 上以 AVX2 编译）。
+#ifndef SM4_BS_WIDTH
+#define SM4_BS_WIDTH 128
+#endif
+#if SM4_BS_WIDTH != 64 && SM4_BS_WIDTH != 128 && SM4_BS_WIDTH != 256
+#error "SM4_BS_WIDTH must be 64, 128 or 256"
+#endif
+#define SM4_BS_BYTES (SM4_BS_WIDTH / 8)
+
+typedef uint64_t sm4_bs_t __attribute__((vector_size(SM4_BS_BYTES)));
+
+#if SM4_BS_WIDTH == 256 && defined(SM4_X86)
+#define SM4_TARGET_BS __attribute__((target("avx2")))
+#else
+#define SM4_TARGET_BS
+#endif
+
+#define SM4_BS_INLINE static inline __attribute__((always_inline))
+
+// 塔域表示：GF(2^8) = GF(2^4)[y] / (y^2 + y + z^3)，GF(2^4) = GF(2)[z] / (z^4 + z + 1)，
+// 字节低 4 位为常数项系数 a0，高 4 位为 y 的系数 a1。
+// S(x) = A·inv(A·x + 0xD3) + 0xD3，把同构 ψ（SM4 域 -> 塔域）并入两端的仿射变换：
+//   输入仿射 u = ψ(A·x + 0xD3)，输出仿射 S = (A·ψ^-1)·inv_tower(u) + 0xD3
+// rows[i] 的第 j 位表示输出第 i 位是否含输入第 j 位
+static const uint8_t sm4_bs_pre_rows[8] = {0xD8, 0x65, 0xBE, 0xE3, 0x93, 0x40, 0xC4, 0x7F};
+static const uint8_t sm4_bs_post_rows[8] = {0x93, 0x45, 0xE4, 0x95, 0x1A, 0xBA, 0x57, 0x19};
+#define SM4_BS_PRE_CONST 0xAC
+#define SM4_BS_POST_CONST 0xD3
+
+// 常量矩阵的仿射变换：矩阵与常数都是公开参数，展开后只剩固定的异或/取反
+SM4_BS_INLINE void sm4_bs_affine(const uint8_t rows[8], uint8_t c, const sm4_bs_t in[8], sm4_bs_t out[8]) {
+#pragma GCC unroll 8
+    for (int i = 0; i < 8; ++i) {
+        sm4_bs_t acc = {0};
+#pragma GCC unroll 8
+        for (int j = 0; j < 8; ++j) {
+            if ((rows[i] >> j) & 1) {
+                acc ^= in[j];
+            }
+        }
+        out[i] = ((c >> i) & 1) ? ~acc : acc;
+    }
+}
+
+// GF(2^4) 乘法，模 z^4 + z + 1
+SM4_BS_INLINE void sm4_bs_gf16_mul(const sm4_bs_t a[4], const sm4_bs_t b[4], sm4_bs_t r[4]) {
+    sm4_bs_t c0 = a[0] & b[0];
+    sm4_bs_t c1 = (a[0] & b[1]) ^ (a[1] & b[0]);
+    sm4_bs_t c2 = (a[0] & b[2]) ^ (a[1] & b[1]) ^ (a[2] & b[0]);
+    sm4_bs_t c3 = (a[0] & b[3]) ^ (a[1] & b[2]) ^ (a[2] & b[1]) ^ (a[3] & b[0]);
+    sm4_bs_t c4 = (a[1] & b[3]) ^ (a[2] & b[2]) ^ (a[3] & b[1]);
+    sm4_bs_t c5 = (a[2] & b[3]) ^ (a[3] & b[2]);
+    sm4_bs_t c6 = a[3] & b[3];
+    r[0] = c0 ^ c4;
+    r[1] = c1 ^ c4 ^ c5;
+    r[2] = c2 ^ c5 ^ c6;
+    r[3] = c3 ^ c6;
+}
+
+// GF(2^4) 平方（线性）
+SM4_BS_INLINE void sm4_bs_gf16_sq(const sm4_bs_t a[4], sm4_bs_t r[4]) {
+    sm4_bs_t t0 = a[0] ^ a[2], t2 = a[1] ^ a[3];
+    r[1] = a[2];
+    r[3] = a[3];
+    r[0] = t0;
+    r[2] = t2;
+}
 
-    // 将明文（16 字节）加载为 4 个大端 32 位字
+// GF(2^8) 塔域求逆：(a1·y + a0)^-1 = (a1·y + a0 + a1)·Δ^-1，Δ = z^3·a1^2 + a1·a0 + a0^2
+// GF(2^4) 中 Δ^-1 = Δ^14 = Δ^2·Δ^4·Δ^8；0 映射到 0，与 S 盒定义一致
+SM4_BS_INLINE void sm4_bs_gf256_inv(sm4_bs_t x[8]) {
+    sm4_bs_t *a0 = x, *a1 = x + 4;
+    sm4_bs_t p[4], d[4], d2[4], d4[4], d8[4], t[4], di[4], s[4];
+
+    // z^3·a1^2 + a0^2，两项都是线性的
+    d[0] = a1[2] ^ a0[0] ^ a0[2];
+    d[1] = a1[1] ^ a1[2] ^ a1[3] ^ a0[2];
+    d[2] = a1[1] ^ a0[1] ^ a0[3];
+    d[3] = a1[0] ^ a1[2] ^ a1[3] ^ a0[3];
+    sm4_bs_gf16_mul(a1, a0, p);
     for (int i = 0; i < 4; ++i) {
-        state[i] = (plaintext[i*4] << 24) | (plaintext[i*4+1] << 16) |
-                   (plaintext[i*4+2] << 8) | plaintext[i*4+3];
+        d[i] ^= p[i];
     }
 
-    sm4_key_schedule(key, rk);        
-    sm4_encrypt_rounds(state, rk);    
+    sm4_bs_gf16_sq(d, d2);
+    sm4_bs_gf16_sq(d2, d4);
+    sm4_bs_gf16_sq(d4, d8);
+    sm4_bs_gf16_mul(d2, d4, t);
+    sm4_bs_gf16_mul(t, d8, di);
 
-    // 将加密后的状态写回密文（大端格式）
     for (int i = 0; i < 4; ++i) {
-        ciphertext[i*4] = (state[i] >> 24) & 0xFF;
-        ciphertext[i*4+1] = (state[i] >> 16) & 0xFF;
-        ciphertext[i*4+2] = (state[i] >> 8) & 0xFF;
-        ciphertext[i*4+3] = state[i] & 0xFF;
+        s[i] = a0[i] ^ a1[i];
+    }
+    sm4_bs_gf16_mul(a1, di, t);
+    sm4_bs_gf16_mul(s, di, a0);
+    for (int i = 0; i < 4; ++i) {
+        a1[i] = t[i];
+    }
+}
+
+// 8 个比特平面上的 SM4 S 盒，x[i] 为字节第 i 位
+SM4_BS_INLINE void sm4_bs_sbox(sm4_bs_t x[8]) {
+    sm4_bs_t u[8];
+    sm4_bs_affine(sm4_bs_pre_rows, SM4_BS_PRE_CONST, x, u);
+    sm4_bs_gf256_inv(u);
+    sm4_bs_affine(sm4_bs_post_rows, SM4_BS_POST_CONST, u, x);
+}
+
+// 8x8 比特矩阵转置：结果第 j 字节的第 i 位 = 输入第 i 字节的第 j 位
+static inline uint64_t sm4_transpose8x8(uint64_t x) {
+    uint64_t t;
+    t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAULL;
+    x ^= t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;
+    x ^= t ^ (t << 14);
+    t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;
+    x ^= t ^ (t << 28);
+    return x;
+}
+
+// 分组 -> 比特平面。分组第 q 字节属于第 q/4 个大端字，其第 r 位是该字的第 8*(3 - q%4) + r 位
+static void sm4_bs_pack(const uint8_t *in, sm4_bs_t x[128]) {
+    uint8_t *planes = (uint8_t *)x;
+    for (int g = 0; g < SM4_BS_BYTES; ++g) {
+        const uint8_t *blk = in + g * 8 * BLOCK_SIZE;
+        for (int q = 0; q < BLOCK_SIZE; ++q) {
+            uint64_t v = 0;
+            for (int i = 0; i < 8; ++i) {
+                v |= (uint64_t)blk[i * BLOCK_SIZE + q] << (8 * i);
+            }
+            v = sm4_transpose8x8(v);
+            int base = (q / 4) * 32 + 8 * (3 - q % 4);
+            for (int r = 0; r < 8; ++r) {
+                planes[(base + r) * SM4_BS_BYTES + g] = (uint8_t)(v >> (8 * r));
+            }
+        }
+    }
+}
+
+// 比特平面 -> 分组，同时完成反序变换 R（输出第 w 个字取自状态字 3 - w）
+static void sm4_bs_unpack(const sm4_bs_t x[128], uint8_t *out) {
+    const uint8_t *planes = (const uint8_t *)x;
+    for (int g = 0; g < SM4_BS_BYTES; ++g) {
+        uint8_t *blk = out + g * 8 * BLOCK_SIZE;
+        for (int q = 0; q < BLOCK_SIZE; ++q) {
+            int base = (3 - q / 4) * 32 + 8 * (3 - q % 4);
+            uint64_t v = 0;
+            for (int r = 0; r < 8; ++r) {
+                v |= (uint64_t)planes[(base + r) * SM4_BS_BYTES + g] << (8 * r);
+            }
+            v = sm4_transpose8x8(v);
+            for (int i = 0; i < 8; ++i) {
+                blk[i * BLOCK_SIZE + q] = (uint8_t)(v >> (8 * i));
+            }
+        }
+    }
+}
+
+// 32 轮：第 i 轮更新状态字 i % 4；轮密钥按位扩展成全 0 / 全 1 掩码
+SM4_TARGET_BS
+static void sm4_bs_rounds(const uint32_t *rk, sm4_bs_t x[128]) {
+    for (int i = 0; i < 32; ++i) {
+        sm4_bs_t *a = x + 32 * (i & 3);
+        const sm4_bs_t *b = x + 32 * ((i + 1) & 3);
+        const sm4_bs_t *c = x + 32 * ((i + 2) & 3);
+        const sm4_bs_t *d = x + 32 * ((i + 3) & 3);
+        sm4_bs_t t[32];
+
+        for (int j = 0; j < 32; ++j) {
+            sm4_bs_t zero = {0};
+            t[j] = b[j] ^ c[j] ^ d[j] ^ (zero - (uint64_t)((rk[i] >> j) & 1));
+        }
+        for (int m = 0; m < 4; ++m) {
+            sm4_bs_sbox(t + 8 * m);
+        }
+        // L：循环左移 r 位后第 j 位来自原来的第 j - r 位
+        for (int j = 0; j < 32; ++j) {
+            a[j] ^= t[j] ^ t[(j + 30) & 31] ^ t[(j + 22) & 31] ^ t[(j + 14) & 31] ^ t[(j + 8) & 31];
+        }
+    }
+}
+
+SM4_TARGET_BS
+static void sm4_bs_blocks(const uint32_t *rk, const uint8_t *in, uint8_t *out, size_t nblocks) {
+    sm4_bs_t x[128];
+
+    for (; nblocks >= SM4_BS_WIDTH; nblocks -= SM4_BS_WIDTH) {
+        sm4_bs_pack(in, x);
+        sm4_bs_rounds(rk, x);
+        sm4_bs_unpack(x, out);
+        in += SM4_BS_WIDTH * BLOCK_SIZE;
+        out += SM4_BS_WIDTH * BLOCK_SIZE;
+    }
+
+    // 尾部补零凑满一组，仍走同一条常数时间路径
+    if (nblocks > 0) {
+        uint8_t buf[SM4_BS_WIDTH * BLOCK_SIZE];
+        memset(buf, 0, sizeof(buf));
+        memcpy(buf, in, nblocks * BLOCK_SIZE);
+        sm4_bs_pack(buf, x);
+        sm4_bs_rounds(rk, x);
+        sm4_bs_unpack(x, buf);
+        memcpy(out, buf, nblocks * BLOCK_SIZE);
+    }
+}
+
+// 比特切片按整组生成密钥流，不足一组同样补齐，保持常数时间
+static void sm4_bs_ctr32(const uint32_t *rk, const uint8_t *in, uint8_t *out, size_t nblocks, uint32_t iv[4]) {
+    uint8_t buf[SM4_BS_WIDTH * BLOCK_SIZE];
+    sm4_ctr32_generic(sm4_bs_blocks, SM4_BS_WIDTH, buf, rk, in, out, nblocks, iv);
+}
+
+static int sm4_bs_supported(void) {
+#if SM4_BS_WIDTH == 256 && defined(SM4_X86)
+    return __builtin_cpu_supports("avx2");
+#else
+    return 1;
+#endif
+}
+
+static int sm4_always_supported(void) {
+    return 1;
+}
+
+typedef struct {
+    const char *name;
+    int (*supported)(void);
+    void (*blocks)(const uint32_t *rk, const uint8_t *in, uint8_t *out, size_t nblocks);
+    void (*ctr32)(const uint32_t *rk, const uint8_t *in, uint8_t *out, size_t nblocks, uint32_t iv[4]);
+    // 多密钥（每个通道独立的轮密钥）；为 NULL 时按相同密钥的连续分组调用 blocks
+    void (*multi)(const sm4_ctx *const ctxs[], const uint8_t *in, uint8_t *out, size_t nblocks);
+} sm4_backend;
+
+// 顺序与 sm4_impl 枚举一致
+static const sm4_backend sm4_backends[SM4_IMPL_COUNT] = {
+    {"ref", sm4_always_supported, sm4_ref_blocks, sm4_ref_ctr32, NULL},
+    {"ttable", sm4_always_supported, sm4_ttable_blocks, sm4_ttable_ctr32, NULL},
+#ifdef SM4_X86
+    {"aesni", sm4_aesni_supported, sm4_aesni_blocks, sm4_aesni_ctr32, NULL},
+    {"aesni-avx2", sm4_avx2_supported, sm4_avx2_blocks, sm4_avx2_ctr32, NULL},
+    {"vaes-avx512", sm4_vaes_supported, sm4_vaes_blocks, sm4_vaes_ctr32, sm4_vaes_multi},
+    {"gfni-avx512", sm4_gfni_supported, sm4_gfni_blocks, sm4_gfni_ctr32, sm4_gfni_multi},
+#else
+    {"aesni", NULL, NULL, NULL, NULL},
+    {"aesni-avx2", NULL, NULL, NULL, NULL},
+    {"vaes-avx512", NULL, NULL, NULL, NULL},
+    {"gfni-avx512", NULL, NULL, NULL, NULL},
+#endif
+    {"bitslice", sm4_bs_supported, sm4_bs_blocks, sm4_bs_ctr32, NULL},
+};
+
+// 自动选择时的优先级，从快到慢
+static const sm4_impl sm4_impl_preference[] = {
+    SM4_IMPL_GFNI_AVX512, SM4_IMPL_VAES_AVX512, SM4_IMPL_AESNI_AVX2, SM4_IMPL_AESNI, SM4_IMPL_TTABLE
+};
+
+static sm4_impl sm4_active_impl = SM4_IMPL_COUNT;
+
+int sm4_impl_available(sm4_impl impl) {
+    if (impl < 0 || impl >= SM4_IMPL_COUNT || sm4_backends[impl].supported == NULL) {
+        return 0;
+    }
+    return sm4_backends[impl].supported();
+}
+
+const char *sm4_impl_name(sm4_impl impl) {
+    if (impl < 0 || impl >= SM4_IMPL_COUNT) {
+        return "unknown";
+    }
+    return sm4_backends[impl].name;
+}
+
+int sm4_set_impl(sm4_impl impl) {
+    if (!sm4_impl_available(impl)) {
+        return -1;
+    }
+    sm4_active_impl = impl;
+    return 0;
+}
+
+// 按 CPUID 选择默认后端。构造函数在 main 之前（进程还是单线程）执行，
+// 之后 sm4_get_impl 只读 sm4_active_impl，多线程同时调用不会竞争写
+__attribute__((constructor)) static void sm4_select_impl(void) {
+#ifdef SM4_X86
+    __builtin_cpu_init();
+#endif
+    if (sm4_active_impl != SM4_IMPL_COUNT) {
+        return;
+    }
+    size_t n = sizeof(sm4_impl_preference) / sizeof(sm4_impl_preference[0]);
+    for (size_t i = 0; i < n; ++i) {
+        if (sm4_impl_available(sm4_impl_preference[i])) {
+            sm4_active_impl = sm4_impl_preference[i];
+            break;
+        }
+    }
+}
+
+sm4_impl sm4_get_impl(void) {
+    // 只有在其他构造函数里、本文件的构造函数之前调用时才会走到这里，此时仍是单线程
+    if (sm4_active_impl == SM4_IMPL_COUNT) {
+        sm4_select_impl();
+    }
+    return sm4_active_impl;
+}
+
+void sm4_encrypt_blocks(const sm4_ctx *ctx, const uint8_t *in, uint8_t *out, size_t nblocks) {
+    sm4_backends[sm4_get_impl()].blocks(ctx->rk, in, out, nblocks);
+}
+
+void sm4_ctr32_encrypt_blocks(const sm4_ctx *ctx, const uint8_t *in, uint8_t *out, size_t nblocks,
+                              const uint8_t ivec[BLOCK_SIZE]) {
+    uint32_t iv[4];
+    for (int j = 0; j < 4; ++j) {
+        iv[j] = load_be32(ivec + j * 4);
+    }
+    sm4_backends[sm4_get_impl()].ctr32(ctx->rk, in, out, nblocks, iv);
+}
+
+void sm4_encrypt_blocks_multi(const sm4_ctx *const ctxs[], const uint8_t *in, uint8_t *out, size_t nblocks) {
+    const sm4_backend *b = &sm4_backends[sm4_get_impl()];
+    if (b->multi != NULL) {
+        b->multi(ctxs, in, out, nblocks);
+    } else {
+        sm4_multi_runs(b->blocks, ctxs, in, out, nblocks);
+    }
+}
+
+#ifndef SM4_NO_MAIN
+// 读取时间戳计数器；非 x86 平台退化为纳秒计时
+static uint64_t read_cycles(void) {
+#ifdef SM4_X86
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+#endif
+}
+
+// 测量轮函数的 cycles/byte：链式加密 65536 个分组，取 5 次中的最小值
+static double rounds_cycles_per_byte(void (*rounds)(uint32_t *, const uint32_t *), const uint32_t *rk) {
+    const int blocks = 1 << 16;
+    uint32_t state[4] = {0x01234567, 0x89ABCDEF, 0xFEDCBA98, 0x76543210};
+    uint64_t best = UINT64_MAX;
+
+    for (int rep = 0; rep < 5; ++rep) {
+        uint64_t start = read_cycles();
+        for (int i = 0; i < blocks; ++i) {
+            rounds(state, rk);
+        }
+        uint64_t cycles = read_cycles() - start;
+        if (cycles < best) {
+            best = cycles;
+        }
+    }
+
+    // 使用结果，防止被编译器整体消除
+    if (state[0] == 0 && state[1] == 0) {
+        printf("\n");
+    }
+    return (double)best / ((double)blocks * BLOCK_SIZE);
+}
+
+// 各后端与参考实现逐字节比对，并测量批量加密的 cycles/byte
+static void compare_backends(const sm4_ctx *ctx) {
+    enum { NBLOCKS = 4096 + 13 };  // 非 16 的倍数，覆盖各后端的尾部处理
+    static uint8_t in[NBLOCKS * BLOCK_SIZE], expect[NBLOCKS * BLOCK_SIZE], out[NBLOCKS * BLOCK_SIZE];
+    static uint8_t ctr_expect[NBLOCKS * BLOCK_SIZE];
+    // 计数器从 0xFFFFFFF9 开始，覆盖 32 位回绕（前 12 字节保持不变）
+    uint8_t ivec[BLOCK_SIZE] = {0x00, 0x00, 0x12, 0x34, 0x56, 0x78, 0x00, 0x00,
+                                0x00, 0x00, 0xAB, 0xCD, 0xFF, 0xFF, 0xFF, 0xF9};
+
+    srand(1);
+    for (size_t i = 0; i < sizeof(in); ++i) {
+        in[i] = rand() & 0xFF;
+    }
+    sm4_set_impl(SM4_IMPL_REF);
+    sm4_encrypt_blocks(ctx, in, expect, NBLOCKS);
+
+    // CTR 期望值：逐个构造计数器分组
+    uint32_t ctr = load_be32(ivec + 12);
+    for (size_t i = 0; i < NBLOCKS; ++i) {
+        uint8_t block[BLOCK_SIZE];
+        memcpy(block, ivec, 12);
+        store_be32(block + 12, ctr++);
+        sm4_encrypt_block(ctx, block, block);
+        for (int j = 0; j < BLOCK_SIZE; ++j) {
+            ctr_expect[i * BLOCK_SIZE + j] = in[i * BLOCK_SIZE + j] ^ block[j];
+        }
+    }
+
+    // 多密钥期望值：3 个密钥交替，既有相同密钥的连续段，也有逐分组切换
+    static sm4_ctx keys[3];
+    static const sm4_ctx *ctxs[NBLOCKS];
+    static uint8_t multi_expect[NBLOCKS * BLOCK_SIZE];
+    for (int k = 0; k < 3; ++k) {
+        uint8_t raw[BLOCK_SIZE];
+        for (int j = 0; j < BLOCK_SIZE; ++j) {
+            raw[j] = rand() & 0xFF;
+        }
+        sm4_set_encrypt_key(&keys[k], raw);
+    }
+    for (size_t i = 0; i < NBLOCKS; ++i) {
+        ctxs[i] = &keys[i < NBLOCKS / 2 ? (i / 20) % 3 : i % 3];
+        sm4_encrypt_block(ctxs[i], in + i * BLOCK_SIZE, multi_expect + i * BLOCK_SIZE);
+    }
+
+    printf("\n%-12s %-6s %-12s %-6s %-12s %s\n", "backend", "match", "cycles/byte", "ctr32", "cycles/byte", "multi-key");
+    for (int impl = 0; impl < SM4_IMPL_COUNT; ++impl) {
+        if (sm4_set_impl(impl) != 0) {
+            printf("%-12s (not supported on this CPU)\n", sm4_impl_name(impl));
+            continue;
+        }
+        sm4_encrypt_blocks(ctx, in, out, NBLOCKS);
+        int match = memcmp(out, expect, sizeof(out)) == 0;
+        sm4_ctr32_encrypt_blocks(ctx, in, out, NBLOCKS, ivec);
+        int ctr_match = memcmp(out, ctr_expect, sizeof(out)) == 0;
+        sm4_encrypt_blocks_multi(ctxs, in, out, NBLOCKS);
+        int multi_match = memcmp(out, multi_expect, sizeof(out)) == 0;
+
+        uint64_t best = UINT64_MAX, ctr_best = UINT64_MAX;
+        for (int rep = 0; rep < 5; ++rep) {
+            uint64_t start = read_cycles();
+            sm4_encrypt_blocks(ctx, in, out, NBLOCKS);
+            uint64_t mid = read_cycles();
+            sm4_ctr32_encrypt_blocks(ctx, in, out, NBLOCKS, ivec);
+            uint64_t end = read_cycles();
+            if (mid - start < best) {
+                best = mid - start;
+            }
+            if (end - mid < ctr_best) {
+                ctr_best = end - mid;
+            }
+        }
+        printf("%-12s %-6s %-12.2f %-6s %-12.2f %s\n", sm4_impl_name(impl), match ? "OK" : "FAIL",
+               (double)best / sizeof(in), ctr_match ? "OK" : "FAIL", (double)ctr_best / sizeof(in),
+               multi_match ? "OK" : "FAIL");
     }
 }
 
@@ -97,8 +1392,14 @@ int main() {
     uint8_t key[BLOCK_SIZE] = { 0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF, 0xFE, 0xDC, 0xBA, 0x98, 0x76, 0x54, 0x32, 0x10};
     uint8_t plaintext[BLOCK_SIZE] = {0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF, 0xFE, 0xDC, 0xBA, 0x98, 0x76, 0x54, 0x32, 0x10};
     uint8_t ciphertext[BLOCK_SIZE];
+    uint8_t decrypted[BLOCK_SIZE];
+
+    sm4_ctx enc_ctx, dec_ctx;
+    sm4_set_encrypt_key(&enc_ctx, key);
+    sm4_set_decrypt_key(&dec_ctx, key);
 
-    sm4_encrypt(plaintext, key, ciphertext);  
+    sm4_encrypt_block(&enc_ctx, plaintext, ciphertext);
+    sm4_encrypt_block(&dec_ctx, ciphertext, decrypted);
 
     printf("Ciphertext: ");
     for (int i = 0; i < BLOCK_SIZE; ++i) {
@@ -106,5 +1407,26 @@ int main() {
     }
     printf("\n");
 
+    printf("Decrypted:  ");
+    for (int i = 0; i < BLOCK_SIZE; ++i) {
+        printf("%02X ", decrypted[i]);
+    }
+    printf("\n");
+    printf("Round trip: %s\n", memcmp(plaintext, decrypted, BLOCK_SIZE) == 0 ? "OK" : "FAIL");
+
+    // 查表轮函数与逐字节 S 盒轮函数的性能对比
+#ifdef SM4_SMALL_TTABLE
+    const char *table_name = "T-table (1 KB)";
+#else
+    const char *table_name = "T-table (4 KB)";
+#endif
+    double ref_cpb = rounds_cycles_per_byte(sm4_encrypt_rounds, enc_ctx.rk);
+    double table_cpb = rounds_cycles_per_byte(sm4_ttable_rounds, enc_ctx.rk);
+    printf("\nsm4_encrypt_rounds (S-box + L): %6.2f cycles/byte\n", ref_cpb);
+    printf("sm4_ttable_rounds  %-14s: %6.2f cycles/byte (%.2fx)\n", table_name, table_cpb, ref_cpb / table_cpb);
+
+    compare_backends(&enc_ctx);
+
     return 0;
-}
\ No newline at end of file
+}
+#endif
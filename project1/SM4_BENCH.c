@@ -0,0 +1,430 @@
+// SM4 / SM4-GCM 基准程序：遍历后端、模式、消息长度和线程数，输出 CSV 或 JSON
+//
+// 编译：gcc -O3 -pthread -DSM4_NO_MAIN -DSM4_GCM_NO_MAIN SM4_BENCH.c SM4.c SM4_GCM.c -o sm4_bench
+// 用法：./sm4_bench [--format csv|json] [--impl all|名称,...] [--mode ecb,ctr,gcm,gcm-shoup]
+//                   [--min 16] [--max 67108864] [--threads 1,2,4] [--bytes 67108864] [--cpu 0]
+// 参数错误（未知选项、格式、后端或模式名，缺少取值）时打印原因并返回 2；--help 打印用法并返回 0
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "sm4.h"
+#include "sm4_gcm.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <x86intrin.h>
+#define BENCH_X86 1
+#endif
+
+#define BENCH_MAX_THREADS 64
+#define BENCH_MIN_SAMPLES 11
+#define BENCH_MAX_SAMPLES 2001
+#define BENCH_SAMPLE_BYTES 4096     // 小消息一个样本内连续处理多次，使计时开销可以忽略
+
+typedef enum {
+    MODE_ECB,           // sm4_encrypt_blocks
+    MODE_CTR,           // sm4_ctr32_encrypt_blocks
+    MODE_GCM,           // 预设密钥的 SM4-GCM 加密（含 J0 与标签），GHASH 用 PCLMULQDQ
+    MODE_GCM_SHOUP,     // 同上，强制使用 4 位 Shoup 表
+    MODE_COUNT
+} bench_mode;
+
+static const char *mode_names[MODE_COUNT] = {"ecb", "ctr", "gcm", "gcm-shoup"};
+
+typedef struct {
+    int format_json;
+    int impls[SM4_IMPL_COUNT];
+    int modes[MODE_COUNT];
+    size_t min_len, max_len;
+    int threads[16];
+    int nthreads;
+    size_t target_bytes;        // 每个测量点至少处理的字节数（不含预热）
+    int cpu;                    // 第一个线程绑定的 CPU，其余依次递增
+} bench_opts;
+
+static uint64_t read_cycles(void) {
+#ifdef BENCH_X86
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void pin_to_cpu(int cpu) {
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(ncpu > 0 ? cpu % ncpu : 0, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// 已排序数组的 p 分位（最近秩）
+static uint64_t percentile(const uint64_t *sorted, size_t n, double p) {
+    size_t idx = (size_t)(p * (n - 1) + 0.5);
+    return sorted[idx < n ? idx : n - 1];
+}
+
+
+// ---------- 单个线程的测量 ----------
+typedef struct {
+    bench_mode mode;
+    size_t len;
+    size_t samples, inner;      // 样本数；每个样本内重复处理的次数
+    int cpu;
+    pthread_barrier_t *start;
+    // 结果
+    uint64_t *ns;               // 每个样本的耗时（纳秒）
+    uint64_t *cycles;           // 每个样本的 TSC 周期
+    uint64_t begin_ns, end_ns;  // 本线程测量阶段的起止时刻
+} bench_job;
+
+static void run_once(bench_mode mode, const sm4_ctx *ctx, const sm4_gcm_key *gk,
+                     uint8_t *buf, size_t len, uint8_t ctr[BLOCK_SIZE], uint8_t tag[BLOCK_SIZE]) {
+    switch (mode) {
+    case MODE_ECB:
+        sm4_encrypt_blocks(ctx, buf, buf, len / BLOCK_SIZE);
+        break;
+    case MODE_CTR:
+        sm4_ctr32_encrypt_blocks(ctx, buf, buf, len / BLOCK_SIZE, ctr);
+        break;
+    default: {
+        sm4_gcm_ctx c;
+        sm4_gcm_init_key(&c, gk, ctr, 12, 1);
+        sm4_gcm_update(&c, buf, buf, len);
+        sm4_gcm_final(&c, tag);
+        break;
+    }
+    }
+}
+
+static void *bench_worker(void *arg) {
+    bench_job *job = (bench_job *)arg;
+    uint8_t key[BLOCK_SIZE], ctr[BLOCK_SIZE] = {0}, tag[BLOCK_SIZE];
+    sm4_ctx ctx;
+    sm4_gcm_key gk;
+
+    pin_to_cpu(job->cpu);
+    for (int i = 0; i < BLOCK_SIZE; i++) {
+        key[i] = (uint8_t)(i * 17 + job->cpu);
+    }
+    sm4_set_encrypt_key(&ctx, key);
+    sm4_gcm_set_key(&gk, key);
+    if (job->mode == MODE_GCM_SHOUP) {
+        gk.gk.use_clmul = 0;
+    }
+
+    // 每个线程各自的缓冲区，64 字节对齐，首次触碰在本线程（NUMA 本地）
+    uint8_t *buf = aligned_alloc(64, (job->len + 63) / 64 * 64);
+    memset(buf, 0x5A, job->len);
+
+    // 预热：至少处理 1 MB 或 3 次，让频率、缓存和分支预测稳定
+    size_t warm = job->len >= (1 << 20) ? 3 : (1 << 20) / job->len;
+    for (size_t i = 0; i < warm; i++) {
+        run_once(job->mode, &ctx, &gk, buf, job->len, ctr, tag);
+    }
+
+    if (job->start != NULL) {
+        pthread_barrier_wait(job->start);
+    }
+    job->begin_ns = now_ns();
+    for (size_t s = 0; s < job->samples; s++) {
+        uint64_t t0 = now_ns();
+        uint64_t c0 = read_cycles();
+        for (size_t r = 0; r < job->inner; r++) {
+            run_once(job->mode, &ctx, &gk, buf, job->len, ctr, tag);
+        }
+        uint64_t c1 = read_cycles();
+        uint64_t t1 = now_ns();
+        job->cycles[s] = c1 - c0;
+        job->ns[s] = t1 - t0;
+    }
+    job->end_ns = now_ns();
+    free(buf);
+    return NULL;
+}
+
+
+// ---------- 一个测量点 ----------
+typedef struct {
+    double cycles_per_byte;     // 中位样本
+    double gbps;                // 所有线程合计：总字节 / 墙钟时间
+    double p50_ns, p99_ns;      // 单条消息的延迟
+    size_t samples;
+} bench_result;
+
+static void bench_point(bench_mode mode, size_t len, int nthreads, const bench_opts *opts, bench_result *res) {
+    size_t inner = len >= BENCH_SAMPLE_BYTES ? 1 : BENCH_SAMPLE_BYTES / len;
+    size_t samples = opts->target_bytes / (len * inner);
+    if (samples < BENCH_MIN_SAMPLES) {
+        samples = BENCH_MIN_SAMPLES;
+    }
+    if (samples > BENCH_MAX_SAMPLES) {
+        samples = BENCH_MAX_SAMPLES;
+    }
+
+    bench_job jobs[BENCH_MAX_THREADS];
+    pthread_t tids[BENCH_MAX_THREADS];
+    pthread_barrier_t barrier;
+    pthread_barrier_init(&barrier, NULL, (unsigned)nthreads + 1);
+
+    for (int t = 0; t < nthreads; t++) {
+        jobs[t].mode = mode;
+        jobs[t].len = len;
+        jobs[t].samples = samples;
+        jobs[t].inner = inner;
+        jobs[t].cpu = opts->cpu + t;
+        jobs[t].start = &barrier;
+        jobs[t].ns = malloc(samples * sizeof(uint64_t));
+        jobs[t].cycles = malloc(samples * sizeof(uint64_t));
+        pthread_create(&tids[t], NULL, bench_worker, &jobs[t]);
+    }
+    pthread_barrier_wait(&barrier);
+    for (int t = 0; t < nthreads; t++) {
+        pthread_join(tids[t], NULL);
+    }
+    pthread_barrier_destroy(&barrier);
+
+    // 墙钟时间取各线程的最早开始到最晚结束（主线程在屏障之后不一定马上被调度）
+    uint64_t begin = jobs[0].begin_ns, end = jobs[0].end_ns;
+    for (int t = 1; t < nthreads; t++) {
+        begin = jobs[t].begin_ns < begin ? jobs[t].begin_ns : begin;
+        end = jobs[t].end_ns > end ? jobs[t].end_ns : end;
+    }
+    uint64_t wall = end - begin;
+
+    // 所有线程的样本合并后取分位数
+    size_t total = samples * (size_t)nthreads;
+    uint64_t *ns = malloc(total * sizeof(uint64_t));
+    uint64_t *cyc = malloc(total * sizeof(uint64_t));
+    for (int t = 0; t < nthreads; t++) {
+        memcpy(ns + t * samples, jobs[t].ns, samples * sizeof(uint64_t));
+        memcpy(cyc + t * samples, jobs[t].cycles, samples * sizeof(uint64_t));
+        free(jobs[t].ns);
+        free(jobs[t].cycles);
+    }
+    qsort(ns, total, sizeof(uint64_t), cmp_u64);
+    qsort(cyc, total, sizeof(uint64_t), cmp_u64);
+
+    double per_sample = (double)(len * inner);
+    res->cycles_per_byte = percentile(cyc, total, 0.5) / per_sample;
+    res->gbps = (double)total * per_sample / (wall > 0 ? wall : 1);
+    res->p50_ns = percentile(ns, total, 0.5) / (double)inner;
+    res->p99_ns = percentile(ns, total, 0.99) / (double)inner;
+    res->samples = total;
+    free(ns);
+    free(cyc);
+}
+
+
+// ---------- 命令行 ----------
+static void usage(FILE *f, const char *prog) {
+    fprintf(f,
+            "usage: %s [options]\n"
+            "  --format csv|json       output format (default csv)\n"
+            "  --impl all|NAME,...     SM4 backends:",
+            prog);
+    for (int i = 0; i < SM4_IMPL_COUNT; i++) {
+        fprintf(f, " %s", sm4_impl_name((sm4_impl)i));
+    }
+    fprintf(f, "\n  --mode all|NAME,...     modes:");
+    for (int i = 0; i < MODE_COUNT; i++) {
+        fprintf(f, " %s", mode_names[i]);
+    }
+    fprintf(f,
+            "\n"
+            "  --min BYTES             smallest message length (default 16)\n"
+            "  --max BYTES             largest message length (default 67108864)\n"
+            "  --threads N,...         concurrent benchmark threads per row (default 1)\n"
+            "  --bytes BYTES           bytes processed per measurement (default 67108864)\n"
+            "  --cpu N                 first CPU to pin threads to, one per thread (default 0)\n"
+            "  --help                  show this message\n");
+}
+
+static void parse_list(const char *arg, const char *const *names, int count, int *flags) {
+    memset(flags, 0, count * sizeof(int));
+    if (strcmp(arg, "all") == 0) {
+        for (int i = 0; i < count; i++) {
+            flags[i] = 1;
+        }
+        return;
+    }
+    char tmp[256];
+    snprintf(tmp, sizeof(tmp), "%s", arg);
+    for (char *tok = strtok(tmp, ","); tok != NULL; tok = strtok(NULL, ",")) {
+        int found = 0;
+        for (int i = 0; i < count; i++) {
+            if (strcmp(tok, names[i]) == 0) {
+                flags[i] = 1;
+                found = 1;
+            }
+        }
+        if (!found) {
+            fprintf(stderr, "unknown name: %s\n", tok);
+            exit(2);
+        }
+    }
+}
+
+static void parse_args(int argc, char **argv, bench_opts *opts) {
+    const char *impl_names[SM4_IMPL_COUNT];
+    for (int i = 0; i < SM4_IMPL_COUNT; i++) {
+        impl_names[i] = sm4_impl_name((sm4_impl)i);
+        opts->impls[i] = 1;
+    }
+    for (int i = 0; i < MODE_COUNT; i++) {
+        opts->modes[i] = 1;
+    }
+    opts->format_json = 0;
+    opts->min_len = 16;
+    opts->max_len = 64u << 20;
+    opts->threads[0] = 1;
+    opts->nthreads = 1;
+    opts->target_bytes = 64u << 20;
+    opts->cpu = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+            usage(stdout, argv[0]);
+            exit(0);
+        }
+        const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+        if (val == NULL) {
+            fprintf(stderr, "missing value for %s\n", argv[i]);
+            usage(stderr, argv[0]);
+            exit(2);
+        }
+        if (strcmp(argv[i], "--format") == 0) {
+            if (strcmp(val, "json") == 0) {
+                opts->format_json = 1;
+            } else if (strcmp(val, "csv") == 0) {
+                opts->format_json = 0;
+            } else {
+                fprintf(stderr, "unknown format: %s\n", val);
+                exit(2);
+            }
+        } else if (strcmp(argv[i], "--impl") == 0) {
+            parse_list(val, impl_names, SM4_IMPL_COUNT, opts->impls);
+        } else if (strcmp(argv[i], "--mode") == 0) {
+            parse_list(val, mode_names, MODE_COUNT, opts->modes);
+        } else if (strcmp(argv[i], "--min") == 0) {
+            opts->min_len = strtoull(val, NULL, 0);
+        } else if (strcmp(argv[i], "--max") == 0) {
+            opts->max_len = strtoull(val, NULL, 0);
+        } else if (strcmp(argv[i], "--bytes") == 0) {
+            opts->target_bytes = strtoull(val, NULL, 0);
+        } else if (strcmp(argv[i], "--cpu") == 0) {
+            opts->cpu = atoi(val);
+        } else if (strcmp(argv[i], "--threads") == 0) {
+            char tmp[256];
+            snprintf(tmp, sizeof(tmp), "%s", val);
+            opts->nthreads = 0;
+            for (char *tok = strtok(tmp, ","); tok != NULL && opts->nthreads < 16; tok = strtok(NULL, ",")) {
+                int t = atoi(tok);
+                opts->threads[opts->nthreads++] = t < 1 ? 1 : t > BENCH_MAX_THREADS ? BENCH_MAX_THREADS : t;
+            }
+        } else {
+            fprintf(stderr, "unknown option: %s\n", argv[i]);
+            usage(stderr, argv[0]);
+            exit(2);
+        }
+        i++;
+    }
+    // 长度按分组向上取整，ECB/CTR 只处理整分组
+    opts->min_len = (opts->min_len + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE;
+    if (opts->min_len == 0) {
+        opts->min_len = BLOCK_SIZE;
+    }
+}
+
+// /proc/cpuinfo 的 model name，用于区分主机类别
+static void cpu_model(char *out, size_t n) {
+    snprintf(out, n, "unknown");
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    if (f == NULL) {
+        return;
+    }
+    char line[512];
+    while (fgets(line, sizeof(line), f) != NULL) {
+        if (strncmp(line, "model name", 10) == 0) {
+            char *p = strchr(line, ':');
+            if (p != NULL) {
+                p += 2;
+                p[strcspn(p, "\n")] = 0;
+                // JSON 字符串中不能有引号和反斜杠
+                for (char *q = p; *q; q++) {
+                    if (*q == '"' || *q == '\\') {
+                        *q = ' ';
+                    }
+                }
+                snprintf(out, n, "%s", p);
+            }
+            break;
+        }
+    }
+    fclose(f);
+}
+
+int main(int argc, char **argv) {
+    bench_opts opts;
+    parse_args(argc, argv, &opts);
+
+    char cpu[256];
+    cpu_model(cpu, sizeof(cpu));
+    if (opts.format_json) {
+        printf("{\n  \"cpu\": \"%s\",\n  \"default_impl\": \"%s\",\n  \"results\": [", cpu, sm4_impl_name(sm4_get_impl()));
+    } else {
+        printf("impl,mode,bytes,threads,samples,cycles_per_byte,gb_per_s,p50_ns,p99_ns\n");
+    }
+
+    int first = 1;
+    for (int impl = 0; impl < SM4_IMPL_COUNT; impl++) {
+        if (!opts.impls[impl] || sm4_set_impl((sm4_impl)impl) != 0) {
+            continue;
+        }
+        for (int mode = 0; mode < MODE_COUNT; mode++) {
+            if (!opts.modes[mode]) {
+                continue;
+            }
+            for (size_t len = opts.min_len; len <= opts.max_len; len *= 4) {
+                for (int t = 0; t < opts.nthreads; t++) {
+                    bench_result r;
+                    bench_point((bench_mode)mode, len, opts.threads[t], &opts, &r);
+                    if (opts.format_json) {
+                        printf("%s\n    {\"impl\": \"%s\", \"mode\": \"%s\", \"bytes\": %zu, \"threads\": %d, "
+                               "\"samples\": %zu, \"cycles_per_byte\": %.3f, \"gb_per_s\": %.3f, "
+                               "\"p50_ns\": %.1f, \"p99_ns\": %.1f}",
+                               first ? "" : ",", sm4_impl_name((sm4_impl)impl), mode_names[mode], len,
+                               opts.threads[t], r.samples, r.cycles_per_byte, r.gbps, r.p50_ns, r.p99_ns);
+                    } else {
+                        printf("%s,%s,%zu,%d,%zu,%.3f,%.3f,%.1f,%.1f\n", sm4_impl_name((sm4_impl)impl),
+                               mode_names[mode], len, opts.threads[t], r.samples, r.cycles_per_byte, r.gbps,
+                               r.p50_ns, r.p99_ns);
+                    }
+                    fflush(stdout);
+                    first = 0;
+                }
+            }
+        }
+    }
+    if (opts.format_json) {
+        printf("\n  ]\n}\n");
+    }
+    return 0;
+}
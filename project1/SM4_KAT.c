@@ -0,0 +1,512 @@
+// SM4 / SM4-GCM 已知答案测试与跨后端差分测试
+//
+// 编译：gcc -O3 -pthread -DSM4_NO_MAIN -DSM4_GCM_NO_MAIN SM4_KAT.c SM4.c SM4_GCM.c -o sm4_kat
+// 用法：./sm4_kat [迭代次数，默认 100000] [随机种子，默认按时间]
+// 全部通过返回 0，否则返回 1 并打印可复现的种子与出错的用例；参数不是合法的非负整数时返回 2
+#include <errno.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "sm4.h"
+#include "sm4_gcm.h"
+
+#define KAT_MAX_BLOCKS 600          // 随机长度上限：覆盖 16 路 / 比特切片 256 路内核及其尾部
+#define KAT_MAX_REPORTS 10          // 最多打印的失败用例数
+
+static int failures = 0;
+
+static void report(const char *what, const char *impl, uint64_t iter, const char *detail) {
+    failures++;
+    if (failures <= KAT_MAX_REPORTS) {
+        printf("FAIL %-24s impl=%-14s iter=%llu %s\n", what, impl, (unsigned long long)iter, detail);
+    }
+}
+
+static void hex_to_bytes(const char *hex, uint8_t *out) {
+    size_t n = strlen(hex) / 2;
+    for (size_t i = 0; i < n; i++) {
+        unsigned v;
+        sscanf(hex + 2 * i, "%2x", &v);
+        out[i] = (uint8_t)v;
+    }
+}
+
+// xorshift64*：可复现的伪随机数，测试用
+static uint64_t rng_state;
+
+static uint64_t rng_next(void) {
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+static size_t rng_below(size_t n) {
+    return (size_t)(rng_next() % n);
+}
+
+static void rng_bytes(uint8_t *p, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        p[i] = (uint8_t)(rng_next() >> 56);
+    }
+}
+
+// 消息长度偏向小值（各内核的尾部处理最容易出错）：3/4 落在 0..63 个分组，其余均匀分布到 KAT_MAX_BLOCKS
+static size_t rng_blocks(void) {
+    return rng_below(4) ? rng_below(64) : rng_below(KAT_MAX_BLOCKS + 1);
+}
+
+
+// ---------- 已知答案 ----------
+// GB/T 32907-2016 附录 A：单次加密、解密，以及同一密钥连续加密 1,000,000 次
+static void kat_sm4(void) {
+    uint8_t key[BLOCK_SIZE], pt[BLOCK_SIZE], expect1[BLOCK_SIZE], expect2[BLOCK_SIZE];
+    hex_to_bytes("0123456789ABCDEFFEDCBA9876543210", key);
+    hex_to_bytes("0123456789ABCDEFFEDCBA9876543210", pt);
+    hex_to_bytes("681EDF34D206965E86B3E94F536E4246", expect1);
+    hex_to_bytes("595298C7C6FD271F0402F804C33D3F66", expect2);
+
+    sm4_ctx ek, dk;
+    sm4_set_encrypt_key(&ek, key);
+    sm4_set_decrypt_key(&dk, key);
+    sm4_impl saved = sm4_get_impl();
+
+    for (int impl = 0; impl < SM4_IMPL_COUNT; impl++) {
+        if (sm4_set_impl((sm4_impl)impl) != 0) {
+            continue;
+        }
+        const char *name = sm4_impl_name((sm4_impl)impl);
+
+        // 16 份相同的明文同时走一遍，确保 SIMD 后端的每个通道都被检查
+        enum { LANES = 16 };
+        uint8_t buf[LANES * BLOCK_SIZE];
+        for (int l = 0; l < LANES; l++) {
+            memcpy(buf + l * BLOCK_SIZE, pt, BLOCK_SIZE);
+        }
+        sm4_encrypt_blocks(&ek, buf, buf, LANES);
+        int ok = 1;
+        for (int l = 0; l < LANES; l++) {
+            ok &= memcmp(buf + l * BLOCK_SIZE, expect1, BLOCK_SIZE) == 0;
+        }
+        sm4_encrypt_blocks(&dk, buf, buf, LANES);
+        for (int l = 0; l < LANES; l++) {
+            ok &= memcmp(buf + l * BLOCK_SIZE, pt, BLOCK_SIZE) == 0;
+        }
+        if (!ok) {
+            report("GB/T 32907 example 1", name, 0, "");
+        }
+
+        // 1,000,000 次迭代：各通道携带同一条链，单分组后端按 1 个通道跑
+        int lanes = impl == SM4_IMPL_REF || impl == SM4_IMPL_TTABLE ? 1 : LANES;
+        for (int l = 0; l < lanes; l++) {
+            memcpy(buf + l * BLOCK_SIZE, pt, BLOCK_SIZE);
+        }
+        for (int i = 0; i < 1000000; i++) {
+            sm4_encrypt_blocks(&ek, buf, buf, lanes);
+        }
+        ok = 1;
+        for (int l = 0; l < lanes; l++) {
+            ok &= memcmp(buf + l * BLOCK_SIZE, expect2, BLOCK_SIZE) == 0;
+        }
+        if (!ok) {
+            report("GB/T 32907 example 2", name, 0, "1,000,000 iterations");
+        }
+        printf("KAT %-14s %s\n", name, ok ? "OK" : "FAIL");
+    }
+    sm4_set_impl(saved);
+}
+
+// RFC 8998 附录 A.1 SM4-GCM，逐个后端
+static void kat_gcm(void) {
+    uint8_t key[BLOCK_SIZE], iv[12], aad[20], pt[64], expect_ct[64], expect_tag[BLOCK_SIZE];
+    hex_to_bytes("0123456789ABCDEFFEDCBA9876543210", key);
+    hex_to_bytes("00001234567800000000ABCD", iv);
+    hex_to_bytes("FEEDFACEDEADBEEFFEEDFACEDEADBEEFABADDAD2", aad);
+    hex_to_bytes("AAAAAAAAAAAAAAAABBBBBBBBBBBBBBBBCCCCCCCCCCCCCCCCDDDDDDDDDDDDDDDD"
+                 "EEEEEEEEEEEEEEEEFFFFFFFFFFFFFFFFEEEEEEEEEEEEEEEEAAAAAAAAAAAAAAAA", pt);
+    hex_to_bytes("17F399F08C67D5EE19D0DC9969C4BB7D5FD46FD3756489069157B282BB200735"
+                 "D82710CA5C22F0CCFA7CBF93D496AC15A56834CBCF98C397B4024A2691233B8D", expect_ct);
+    hex_to_bytes("83DE3541E4C2B58177E065A9BF7B62EC", expect_tag);
+    sm4_impl saved = sm4_get_impl();
+
+    for (int impl = 0; impl < SM4_IMPL_COUNT; impl++) {
+        if (sm4_set_impl((sm4_impl)impl) != 0) {
+            continue;
+        }
+        uint8_t ct[64], dec[64], tag[BLOCK_SIZE], tag2[BLOCK_SIZE];
+        gcm_encrypt(pt, 64, key, iv, 12, aad, 20, ct, tag);
+        gcm_decrypt(ct, 64, key, iv, 12, aad, 20, dec, tag2);
+        int ok = memcmp(ct, expect_ct, 64) == 0 && memcmp(tag, expect_tag, BLOCK_SIZE) == 0 &&
+                 memcmp(dec, pt, 64) == 0 && memcmp(tag2, expect_tag, BLOCK_SIZE) == 0;
+        if (!ok) {
+            report("RFC 8998 SM4-GCM", sm4_impl_name((sm4_impl)impl), 0, "");
+        }
+        printf("KAT %-14s SM4-GCM %s\n", sm4_impl_name((sm4_impl)impl), ok ? "OK" : "FAIL");
+    }
+    sm4_set_impl(saved);
+}
+
+
+// ---------- SM4 差分 ----------
+// 每次迭代随机选择密钥、分组数、输入/输出的字节偏移（0..63）以及是否原地，
+// 参考后端（逐字节 S 盒）的结果作为基准，其余后端逐字节比较：
+// ECB 加密、ECB 解密、CTR32（计数器有时贴近 2^32 回绕）、多密钥
+static void diff_sm4(uint64_t iters) {
+    static uint8_t src[KAT_MAX_BLOCKS * BLOCK_SIZE + 64];
+    static uint8_t ref_enc[KAT_MAX_BLOCKS * BLOCK_SIZE], ref_dec[KAT_MAX_BLOCKS * BLOCK_SIZE];
+    static uint8_t ref_ctr[KAT_MAX_BLOCKS * BLOCK_SIZE], ref_multi[KAT_MAX_BLOCKS * BLOCK_SIZE];
+    static uint8_t in_buf[KAT_MAX_BLOCKS * BLOCK_SIZE + 64], out_buf[KAT_MAX_BLOCKS * BLOCK_SIZE + 64];
+    static const sm4_ctx *ctxs[KAT_MAX_BLOCKS];
+    sm4_impl saved = sm4_get_impl();
+    int impls[SM4_IMPL_COUNT], nimpls = 0;
+    for (int impl = SM4_IMPL_REF + 1; impl < SM4_IMPL_COUNT; impl++) {
+        if (sm4_impl_available((sm4_impl)impl)) {
+            impls[nimpls++] = impl;
+        }
+    }
+
+    for (uint64_t it = 0; it < iters; it++) {
+        uint8_t key[BLOCK_SIZE], iv[BLOCK_SIZE];
+        sm4_ctx ek, dk, mk[4];
+        size_t n = rng_blocks();
+        size_t bytes = n * BLOCK_SIZE;
+        rng_bytes(key, BLOCK_SIZE);
+        rng_bytes(iv, BLOCK_SIZE);
+        if (rng_below(4) == 0) {
+            memset(iv + 12, 0xFF, 4);
+            iv[15] -= (uint8_t)rng_below(20);
+        }
+        sm4_set_encrypt_key(&ek, key);
+        sm4_set_decrypt_key(&dk, key);
+        for (int k = 0; k < 4; k++) {
+            uint8_t kk[BLOCK_SIZE];
+            rng_bytes(kk, BLOCK_SIZE);
+            sm4_set_encrypt_key(&mk[k], kk);
+        }
+        // 多密钥：随机长度的同密钥段与逐分组交替混合
+        for (size_t i = 0; i < n;) {
+            size_t run = 1 + rng_below(rng_below(2) ? 2 : 24);
+            const sm4_ctx *c = &mk[rng_below(4)];
+            for (; run > 0 && i < n; run--, i++) {
+                ctxs[i] = c;
+            }
+        }
+        rng_bytes(src, bytes);
+
+        sm4_set_impl(SM4_IMPL_REF);
+        sm4_encrypt_blocks(&ek, src, ref_enc, n);
+        sm4_encrypt_blocks(&dk, src, ref_dec, n);
+        sm4_ctr32_encrypt_blocks(&ek, src, ref_ctr, n, iv);
+        sm4_encrypt_blocks_multi(ctxs, src, ref_multi, n);
+
+        for (int j = 0; j < nimpls; j++) {
+            const char *name = sm4_impl_name((sm4_impl)impls[j]);
+            size_t in_off = rng_below(64), out_off = rng_below(64);
+            int in_place = rng_below(3) == 0;
+            uint8_t *in = in_buf + in_off;
+            uint8_t *out = in_place ? in : out_buf + out_off;
+            char detail[96];
+            snprintf(detail, sizeof(detail), "blocks=%zu in_off=%zu out_off=%zu in_place=%d", n, in_off,
+                     in_place ? in_off : out_off, in_place);
+            sm4_set_impl((sm4_impl)impls[j]);
+
+            memcpy(in, src, bytes);
+            sm4_encrypt_blocks(&ek, in, out, n);
+            if (memcmp(out, ref_enc, bytes) != 0) {
+                report("ecb encrypt", name, it, detail);
+            }
+            memcpy(in, src, bytes);
+            sm4_encrypt_blocks(&dk, in, out, n);
+            if (memcmp(out, ref_dec, bytes) != 0) {
+                report("ecb decrypt", name, it, detail);
+            }
+            memcpy(in, src, bytes);
+            sm4_ctr32_encrypt_blocks(&ek, in, out, n, iv);
+            if (memcmp(out, ref_ctr, bytes) != 0) {
+                report("ctr32", name, it, detail);
+            }
+            memcpy(in, src, bytes);
+            sm4_encrypt_blocks_multi(ctxs, in, out, n);
+            if (memcmp(out, ref_multi, bytes) != 0) {
+                report("multi-key", name, it, detail);
+            }
+        }
+    }
+    sm4_set_impl(saved);
+}
+
+
+// ---------- SM4-GCM 差分 ----------
+// 基准：参考后端 + Shoup 表 GHASH 的一次性加密。被测：每个 SM4 后端下的
+// CLMUL 一次性接口、随机分块的流式接口（原地）、批量接口、多线程接口，以及解密与标签校验
+static void diff_gcm(uint64_t iters) {
+    enum { MAX_LEN = 2048 + 31, BATCH = 5 };
+    static uint8_t msg[BATCH][MAX_LEN], ref_ct[BATCH][MAX_LEN], out[BATCH][MAX_LEN + 64];
+    sm4_impl saved = sm4_get_impl();
+
+    for (uint64_t it = 0; it < iters; it++) {
+        uint8_t raw[BLOCK_SIZE], iv[BATCH][64], aad[BATCH][80], ref_tag[BATCH][BLOCK_SIZE];
+        size_t len[BATCH], iv_len[BATCH], aad_len[BATCH];
+        rng_bytes(raw, BLOCK_SIZE);
+        for (int p = 0; p < BATCH; p++) {
+            len[p] = rng_below(2) ? rng_below(200) : rng_below(MAX_LEN + 1);
+            iv_len[p] = rng_below(2) ? 12 : 1 + rng_below(64);
+            aad_len[p] = rng_below(81);
+            rng_bytes(msg[p], len[p]);
+            rng_bytes(iv[p], iv_len[p]);
+            rng_bytes(aad[p], aad_len[p]);
+        }
+
+        sm4_gcm_key ref_key;
+        sm4_set_impl(SM4_IMPL_REF);
+        sm4_gcm_set_key(&ref_key, raw);
+        ref_key.gk.use_clmul = 0;
+        for (int p = 0; p < BATCH; p++) {
+            sm4_gcm_ctx c;
+            sm4_gcm_init_key(&c, &ref_key, iv[p], iv_len[p], 1);
+            sm4_gcm_update_aad(&c, aad[p], aad_len[p]);
+            sm4_gcm_update(&c, msg[p], ref_ct[p], len[p]);
+            sm4_gcm_final(&c, ref_tag[p]);
+        }
+
+        for (int impl = 0; impl < SM4_IMPL_COUNT; impl++) {
+            if (sm4_set_impl((sm4_impl)impl) != 0) {
+                continue;
+            }
+            const char *name = sm4_impl_name((sm4_impl)impl);
+            sm4_gcm_key key;
+            sm4_gcm_set_key(&key, raw);
+            uint8_t tag[BLOCK_SIZE];
+            char detail[96];
+            int p = (int)rng_below(BATCH);
+            snprintf(detail, sizeof(detail), "len=%zu iv_len=%zu aad_len=%zu", len[p], iv_len[p], aad_len[p]);
+
+            // 一次性接口（默认 GHASH 实现），输出偏移随机
+            uint8_t *o = out[p] + rng_below(64);
+            gcm_encrypt(msg[p], len[p], raw, iv[p], iv_len[p], aad[p], aad_len[p], o, tag);
+            if (memcmp(o, ref_ct[p], len[p]) != 0 || memcmp(tag, ref_tag[p], BLOCK_SIZE) != 0) {
+                report("gcm one-shot", name, it, detail);
+            }
+
+            // 流式：AAD 与数据都随机分块，原地加密
+            sm4_gcm_ctx c;
+            memcpy(o, msg[p], len[p]);
+            sm4_gcm_init_key(&c, &key, iv[p], iv_len[p], 1);
+            for (size_t off = 0; off < aad_len[p];) {
+                size_t k = 1 + rng_below(aad_len[p] - off);
+                sm4_gcm_update_aad(&c, aad[p] + off, k);
+                off += k;
+            }
+            for (size_t off = 0; off < len[p];) {
+                size_t k = 1 + rng_below(rng_below(2) ? 40 : len[p] - off);
+                k = k < len[p] - off ? k : len[p] - off;
+                sm4_gcm_update(&c, o + off, o + off, k);
+                off += k;
+            }
+            sm4_gcm_final(&c, tag);
+            if (memcmp(o, ref_ct[p], len[p]) != 0 || memcmp(tag, ref_tag[p], BLOCK_SIZE) != 0) {
+                report("gcm streaming", name, it, detail);
+            }
+
+            // 流式解密 + 校验，篡改一个比特后必须失败
+            sm4_gcm_init_key(&c, &key, iv[p], iv_len[p], 0);
+            sm4_gcm_update_aad(&c, aad[p], aad_len[p]);
+            sm4_gcm_update(&c, o, o, len[p]);
+            if (sm4_gcm_verify(&c, ref_tag[p], BLOCK_SIZE) != 0 || memcmp(o, msg[p], len[p]) != 0) {
+                report("gcm decrypt/verify", name, it, detail);
+            }
+            uint8_t bad_tag[BLOCK_SIZE];
+            memcpy(bad_tag, ref_tag[p], BLOCK_SIZE);
+            bad_tag[rng_below(BLOCK_SIZE)] ^= (uint8_t)(1u << rng_below(8));
+            sm4_gcm_init_key(&c, &key, iv[p], iv_len[p], 0);
+            sm4_gcm_update_aad(&c, aad[p], aad_len[p]);
+            sm4_gcm_update(&c, ref_ct[p], o, len[p]);
+            if (sm4_gcm_verify(&c, bad_tag, BLOCK_SIZE) == 0) {
+                report("gcm tampered tag", name, it, detail);
+            }
+
+            // 批量接口：所有包一起
+            sm4_gcm_packet pkts[BATCH];
+            uint8_t tags[BATCH][BLOCK_SIZE];
+            for (int q = 0; q < BATCH; q++) {
+                pkts[q] = (sm4_gcm_packet){&key, iv[q], iv_len[q], aad[q], aad_len[q], msg[q], out[q], len[q], tags[q]};
+            }
+            sm4_gcm_seal_batch(pkts, BATCH);
+            for (int q = 0; q < BATCH; q++) {
+                if (memcmp(out[q], ref_ct[q], len[q]) != 0 || memcmp(tags[q], ref_tag[q], BLOCK_SIZE) != 0) {
+                    report("gcm seal_batch", name, it, "");
+                }
+            }
+
+            // 多线程接口（消息较小，走单线程回退路径；并行折叠由 diff_gcm_mt 覆盖）
+            sm4_gcm_encrypt_mt(&key, iv[p], iv_len[p], aad[p], aad_len[p], msg[p], out[p], len[p], tag, 4);
+            if (memcmp(out[p], ref_ct[p], len[p]) != 0 || memcmp(tag, ref_tag[p], BLOCK_SIZE) != 0) {
+                report("gcm encrypt_mt", name, it, detail);
+            }
+        }
+    }
+    sm4_set_impl(saved);
+}
+
+// ---------- SM4-GCM 多线程差分 ----------
+// 消息超过 KAT_MT_MIN_BLOCKS × 线程数，保证 sm4_gcm_encrypt_mt / decrypt_mt 真正切段并行，
+// 走 S = S·H^{n_i} ⊕ P_i 的折叠路径；基准为参考后端 + Shoup 表 GHASH 的流式加密
+#define KAT_MT_MIN_BLOCKS 4096      // 与 SM4_GCM.c 的 GCM_MT_MIN_BLOCKS 一致
+#define KAT_MT_MAX_THREADS 4
+
+// 线程数为 0、负数或超过上限时必须按单线程 / 上限处理：消息足够大（超过 64 个线程的最小分段），
+// 错误的钳位会让线程数越过内部数组的上限
+static void gcm_mt_thread_counts(void) {
+    static const int counts[] = {-1, 0, -1000, 1000};
+    size_t len = 65 * KAT_MT_MIN_BLOCKS * BLOCK_SIZE + 7;
+    uint8_t *msg = malloc(len), *ct = malloc(len), *out = malloc(len);
+    uint8_t raw[BLOCK_SIZE], iv[12], tag[BLOCK_SIZE], tag2[BLOCK_SIZE];
+    rng_bytes(msg, len);
+    rng_bytes(raw, BLOCK_SIZE);
+    rng_bytes(iv, sizeof(iv));
+
+    sm4_gcm_key key;
+    sm4_gcm_set_key(&key, raw);
+    sm4_gcm_encrypt_mt(&key, iv, sizeof(iv), NULL, 0, msg, ct, len, tag, 1);
+    for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        char detail[32];
+        snprintf(detail, sizeof(detail), "threads=%d", counts[i]);
+        if (sm4_gcm_encrypt_mt(&key, iv, sizeof(iv), NULL, 0, msg, out, len, tag2, counts[i]) != 0 ||
+            memcmp(out, ct, len) != 0 || memcmp(tag, tag2, BLOCK_SIZE) != 0) {
+            report("gcm encrypt_mt threads", sm4_impl_name(sm4_get_impl()), 0, detail);
+        }
+        if (sm4_gcm_decrypt_mt(&key, iv, sizeof(iv), NULL, 0, ct, out, len, tag, BLOCK_SIZE, counts[i]) != 0 ||
+            memcmp(out, msg, len) != 0) {
+            report("gcm decrypt_mt threads", sm4_impl_name(sm4_get_impl()), 0, detail);
+        }
+    }
+    free(msg);
+    free(ct);
+    free(out);
+}
+
+static void diff_gcm_mt(uint64_t iters) {
+    enum { MAX_LEN = (KAT_MT_MAX_THREADS + 2) * KAT_MT_MIN_BLOCKS * BLOCK_SIZE + BLOCK_SIZE };
+    static uint8_t msg[MAX_LEN], ref_ct[MAX_LEN], out[MAX_LEN];
+    sm4_impl saved = sm4_get_impl();
+
+    gcm_mt_thread_counts();
+
+    for (uint64_t it = 0; it < iters; it++) {
+        uint8_t raw[BLOCK_SIZE], iv[64], aad[80], ref_tag[BLOCK_SIZE];
+        // 段长是 16 分组的整数倍，总分组数随机，最后一段长度不规则；再加不足一个分组的尾部
+        int nthreads = 2 + (int)rng_below(KAT_MT_MAX_THREADS - 1);
+        size_t nblocks = (size_t)nthreads * KAT_MT_MIN_BLOCKS + rng_below(2 * KAT_MT_MIN_BLOCKS);
+        size_t len = nblocks * BLOCK_SIZE + rng_below(BLOCK_SIZE);
+        size_t iv_len = rng_below(2) ? 12 : 1 + rng_below(64);
+        size_t aad_len = rng_below(81);
+        rng_bytes(raw, BLOCK_SIZE);
+        rng_bytes(msg, len);
+        rng_bytes(iv, iv_len);
+        rng_bytes(aad, aad_len);
+
+        sm4_gcm_key ref_key;
+        sm4_gcm_ctx c;
+        sm4_set_impl(SM4_IMPL_REF);
+        sm4_gcm_set_key(&ref_key, raw);
+        ref_key.gk.use_clmul = 0;
+        sm4_gcm_init_key(&c, &ref_key, iv, iv_len, 1);
+        sm4_gcm_update_aad(&c, aad, aad_len);
+        sm4_gcm_update(&c, msg, ref_ct, len);
+        sm4_gcm_final(&c, ref_tag);
+
+        char detail[96];
+        snprintf(detail, sizeof(detail), "len=%zu iv_len=%zu aad_len=%zu threads=%d", len, iv_len, aad_len, nthreads);
+        for (int impl = 0; impl < SM4_IMPL_COUNT; impl++) {
+            if (sm4_set_impl((sm4_impl)impl) != 0) {
+                continue;
+            }
+            const char *name = sm4_impl_name((sm4_impl)impl);
+            sm4_gcm_key key;
+            sm4_gcm_set_key(&key, raw);
+            uint8_t tag[BLOCK_SIZE];
+
+            if (sm4_gcm_encrypt_mt(&key, iv, iv_len, aad, aad_len, msg, out, len, tag, nthreads) != 0 ||
+                memcmp(out, ref_ct, len) != 0 || memcmp(tag, ref_tag, BLOCK_SIZE) != 0) {
+                report("gcm encrypt_mt (split)", name, it, detail);
+            }
+
+            // 原地解密；篡改一个比特后必须失败
+            if (sm4_gcm_decrypt_mt(&key, iv, iv_len, aad, aad_len, out, out, len, ref_tag, BLOCK_SIZE, nthreads) != 0 ||
+                memcmp(out, msg, len) != 0) {
+                report("gcm decrypt_mt (split)", name, it, detail);
+            }
+            uint8_t bad_tag[BLOCK_SIZE];
+            memcpy(bad_tag, ref_tag, BLOCK_SIZE);
+            bad_tag[rng_below(BLOCK_SIZE)] ^= (uint8_t)(1u << rng_below(8));
+            if (sm4_gcm_decrypt_mt(&key, iv, iv_len, aad, aad_len, ref_ct, out, len, bad_tag, BLOCK_SIZE, nthreads) == 0) {
+                report("gcm decrypt_mt tampered", name, it, detail);
+            }
+        }
+    }
+    sm4_set_impl(saved);
+}
+
+// 严格解析非负整数（十进制或 0x 十六进制），不接受空串、负号、多余字符和溢出
+static int parse_u64(const char *s, uint64_t *v) {
+    char *end;
+    while (*s == ' ' || *s == '\t') {
+        s++;
+    }
+    if (*s == '-' || *s == '\0') {
+        return -1;
+    }
+    errno = 0;
+    unsigned long long x = strtoull(s, &end, 0);
+    if (errno != 0 || *end != '\0') {
+        return -1;
+    }
+    *v = (uint64_t)x;
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    uint64_t iters = 100000;
+    uint64_t seed = (uint64_t)time(NULL);
+    if (argc > 3 || (argc > 1 && parse_u64(argv[1], &iters) != 0) ||
+        (argc > 2 && parse_u64(argv[2], &seed) != 0)) {
+        fprintf(stderr, "usage: %s [iterations] [seed]\n", argv[0]);
+        return 2;
+    }
+    rng_state = seed ? seed : 1;
+    printf("seed=%llu iterations=%llu\n", (unsigned long long)seed, (unsigned long long)iters);
+
+    kat_sm4();
+    kat_gcm();
+
+    clock_t t0 = clock();
+    diff_sm4(iters);
+    printf("SM4 differential (%llu iterations x ecb/dec/ctr32/multi x backends): %s, %.1f s\n",
+           (unsigned long long)iters, failures ? "FAIL" : "OK", (double)(clock() - t0) / CLOCKS_PER_SEC);
+
+    int before = failures;
+    t0 = clock();
+    uint64_t gcm_iters = iters / 20 > 0 ? iters / 20 : 1;
+    diff_gcm(gcm_iters);
+    printf("SM4-GCM differential (%llu iterations x backends): %s, %.1f s\n",
+           (unsigned long long)gcm_iters, failures > before ? "FAIL" : "OK", (double)(clock() - t0) / CLOCKS_PER_SEC);
+
+    before = failures;
+    t0 = clock();
+    uint64_t mt_iters = iters / 2000 > 0 ? iters / 2000 : 1;
+    diff_gcm_mt(mt_iters);
+    printf("SM4-GCM multi-thread differential (%llu iterations x backends, 2..%d threads): %s, %.1f s\n",
+           (unsigned long long)mt_iters, KAT_MT_MAX_THREADS, failures > before ? "FAIL" : "OK",
+           (double)(clock() - t0) / CLOCKS_PER_SEC);
+
+    if (failures > 0) {
+        printf("%d failure(s); rerun with: ./sm4_kat %llu %llu\n", failures, (unsigned long long)iters,
+               (unsigned long long)seed);
+        return 1;
+    }
+    printf("all tests passed\n");
+    return 0;
+}
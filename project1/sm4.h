@@ -0,0 +1,55 @@
+#ifndef SM4_H
+#define SM4_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BLOCK_SIZE 16
+
+// SM4 密钥上下文：32 个轮密钥在设置密钥时计算一次，之后每个分组只做轮运算
+typedef struct {
+    uint32_t rk[32];
+} sm4_ctx;
+
+// 加密密钥：正序轮密钥 rk[0..31]
+void sm4_set_encrypt_key(sm4_ctx *ctx, const uint8_t key[BLOCK_SIZE]);
+
+// 解密密钥：逆序轮密钥 rk[31..0]，配合 sm4_encrypt_block 即完成解密
+void sm4_set_decrypt_key(sm4_ctx *ctx, const uint8_t key[BLOCK_SIZE]);
+
+// 单分组运算（in 与 out 可以重叠）
+void sm4_encrypt_block(const sm4_ctx *ctx, const uint8_t in[BLOCK_SIZE], uint8_t out[BLOCK_SIZE]);
+
+// 多分组后端：默认按 CPUID 在运行时选择最快的可用实现，也可手动指定（测试、基准）
+typedef enum {
+    SM4_IMPL_REF,           // 逐字节 S 盒 + L，参考实现
+    SM4_IMPL_TTABLE,        // S 盒与 L 合并的 T 表
+    SM4_IMPL_AESNI,         // SSSE3 + AES-NI，每次 4 个分组
+    SM4_IMPL_AESNI_AVX2,    // AVX2 + AES-NI，每次 8 个分组
+    SM4_IMPL_VAES_AVX512,   // AVX-512 + VAES，每次 16 个分组
+    SM4_IMPL_GFNI_AVX512,   // AVX-512 + GFNI，每次 16 个分组
+    SM4_IMPL_BITSLICE,      // 比特切片，常数时间，每次 SM4_BS_WIDTH（64/128/256）个分组
+    SM4_IMPL_COUNT
+} sm4_impl;
+
+int sm4_impl_available(sm4_impl impl);
+const char *sm4_impl_name(sm4_impl impl);
+// 强制使用指定后端，CPU 不支持时返回 -1
+int sm4_set_impl(sm4_impl impl);
+sm4_impl sm4_get_impl(void);
+
+// 连续 nblocks 个分组（ECB 方式）交给当前后端处理，in 与 out 可以相同
+void sm4_encrypt_blocks(const sm4_ctx *ctx, const uint8_t *in, uint8_t *out, size_t nblocks);
+
+// CTR 模式（32 位计数器，即 GCM 的 inc32）：out = in ⊕ E(ivec), in ⊕ E(inc32(ivec)), ...
+// 计数器分组由 SIMD 后端直接在转置后的寄存器中构造；ivec 不会被修改，由调用者前进 nblocks
+void sm4_ctr32_encrypt_blocks(const sm4_ctx *ctx, const uint8_t *in, uint8_t *out, size_t nblocks,
+                              const uint8_t ivec[BLOCK_SIZE]);
+
+// 多密钥：第 i 个分组使用 ctxs[i]（ECB 方式），AVX-512 后端在同一组 16 个通道中混合不同密钥
+void sm4_encrypt_blocks_multi(const sm4_ctx *const ctxs[], const uint8_t *in, uint8_t *out, size_t nblocks);
+
+// 一次性接口：每次调用都会重新做密钥扩展，批量数据请使用 sm4_ctx
+void sm4_encrypt(const uint8_t *plaintext, const uint8_t *key, uint8_t *ciphertext);
+
+#endif
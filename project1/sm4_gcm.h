@@ -0,0 +1,100 @@
+#ifndef SM4_GCM_H
+#define SM4_GCM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sm4.h"
+
+// GHASH 密钥：在密钥设置时一次性预计算
+typedef struct {
+    uint8_t H[BLOCK_SIZE];
+    uint8_t Hpow[8][BLOCK_SIZE];    // CLMUL 用：字节反序后的 H^1 .. H^8
+    uint64_t HL[16], HH[16];        // 无 CLMUL 时的 4 位 Shoup 表：HH/HL[i] = i·H 的高/低 64 位
+    int use_clmul;
+} ghash_key;
+
+void ghash_init(ghash_key *key, const uint8_t H[BLOCK_SIZE]);
+
+// GCM 密钥：轮密钥 + GHASH 预计算表，同一密钥的多条消息（多个连接/记录）共用
+typedef struct {
+    sm4_ctx sm4;
+    ghash_key gk;
+    int allow_short_tags;           // 见 sm4_gcm_allow_short_tags
+} sm4_gcm_key;
+
+void sm4_gcm_set_key(sm4_gcm_key *key, const uint8_t raw[BLOCK_SIZE]);
+
+// 校验时接受的标签长度（SP 800-38D 5.2.1.2）：默认只接受 16/15/14/13/12 字节，
+// 其他长度一律验证失败；allow 非 0 时额外接受 8 和 4 字节（只应在按附录 C 限制了消息长度和验证次数的场合开启）
+void sm4_gcm_allow_short_tags(sm4_gcm_key *key, int allow);
+
+// 同一个 IV 下明文（密文）最多 2^32 - 2 个分组，即 2^36 - 32 字节；超过后计数器会绕回 J0
+#define SM4_GCM_MAX_TEXT_LEN ((1ULL << 36) - 32)
+
+// 流式 SM4-GCM 上下文：只缓存不足一个分组的部分，不分配内存、不复制数据
+typedef struct {
+    sm4_gcm_key key;
+    uint8_t J0[BLOCK_SIZE];
+    uint8_t counter[BLOCK_SIZE];    // 下一个计数器分组（inc32 递增）
+    uint8_t Y[BLOCK_SIZE];          // GHASH 状态：AAD、密文、长度分组依次吸收
+    uint8_t buf[BLOCK_SIZE];        // 未满分组：AAD 阶段存 AAD，数据阶段存密文
+    uint8_t keystream[BLOCK_SIZE];  // 未满分组剩余的密钥流
+    size_t buf_len;
+    uint64_t aad_len, text_len;     // 字节数，final 时换算为比特写入长度分组
+    int encrypt;
+    int aad_done;
+} sm4_gcm_ctx;
+
+// 初始化：encrypt 为 1 表示加密，0 表示解密
+void sm4_gcm_init(sm4_gcm_ctx *ctx, const uint8_t key[BLOCK_SIZE], const uint8_t *iv, size_t iv_len, int encrypt);
+// 使用预先设置好的密钥，省去每条消息的密钥扩展和 H 计算
+void sm4_gcm_init_key(sm4_gcm_ctx *ctx, const sm4_gcm_key *key, const uint8_t *iv, size_t iv_len, int encrypt);
+
+// 追加 AAD，可多次调用，必须在第一次 sm4_gcm_update 之前；
+// 之后再调用不做任何处理，返回 -1（否则标签会静默出错）；成功返回 0
+int sm4_gcm_update_aad(sm4_gcm_ctx *ctx, const uint8_t *aad, size_t len);
+
+// 追加任意长度的数据，out 可以等于 in（原地加解密）。
+// 累计长度超过 SM4_GCM_MAX_TEXT_LEN 时不处理本次数据、不写 out，返回 -1；否则返回 0
+int sm4_gcm_update(sm4_gcm_ctx *ctx, const uint8_t *in, uint8_t *out, size_t len);
+
+// 输出 16 字节认证标签
+void sm4_gcm_final(sm4_gcm_ctx *ctx, uint8_t tag[BLOCK_SIZE]);
+
+// 解密结束时校验标签（常数时间比较），一致返回 0，否则返回 -1；tag_len 不在允许的长度内时返回 -1
+int sm4_gcm_verify(sm4_gcm_ctx *ctx, const uint8_t *tag, size_t tag_len);
+
+// 批量加密：一次调用加密 n 个相互独立的小包（各自的密钥、IV、AAD），
+// 所有包的 SM4 分组混合填满 SIMD 通道，GHASH 链以多路交错并行计算；out 可以等于 in
+typedef struct {
+    const sm4_gcm_key *key;
+    const uint8_t *iv;
+    size_t iv_len;
+    const uint8_t *aad;
+    size_t aad_len;
+    const uint8_t *in;
+    uint8_t *out;
+    size_t len;
+    uint8_t *tag;           // 16 字节
+} sm4_gcm_packet;
+
+void sm4_gcm_seal_batch(const sm4_gcm_packet *pkts, size_t n);
+
+// 多线程加解密超大消息：整分组切成 nthreads 段并行做 CTR + 部分 GHASH，再用 H 的幂合并，
+// 结果与单线程完全相同。nthreads <= 1 或消息较小时在当前线程完成；out 可以等于 in。
+// len 超过 SM4_GCM_MAX_TEXT_LEN 时不做任何处理，返回 -1；否则返回 0
+int sm4_gcm_encrypt_mt(const sm4_gcm_key *key, const uint8_t *iv, size_t iv_len,
+                       const uint8_t *aad, size_t aad_len, const uint8_t *in, uint8_t *out, size_t len,
+                       uint8_t tag[BLOCK_SIZE], int nthreads);
+// 标签一致返回 0，否则返回 -1（此时 out 中的明文不可使用）。
+// 标签长度的限制与 sm4_gcm_verify 相同；len 或 tag_len 不合规时不解密，直接返回 -1
+int sm4_gcm_decrypt_mt(const sm4_gcm_key *key, const uint8_t *iv, size_t iv_len,
+                       const uint8_t *aad, size_t aad_len, const uint8_t *in, uint8_t *out, size_t len,
+                       const uint8_t *tag, size_t tag_len, int nthreads);
+
+// 一次性接口
+void gcm_encrypt(const uint8_t *plaintext, size_t plaintext_len, const uint8_t *key, const uint8_t *iv, size_t iv_len, const uint8_t *aad, size_t aad_len, uint8_t *ciphertext, uint8_t *auth_tag);
+void gcm_decrypt(const uint8_t *ciphertext, size_t ciphertext_len, const uint8_t *key, const uint8_t *iv, size_t iv_len, const uint8_t *aad, size_t aad_len, uint8_t *plaintext, uint8_t *auth_tag);
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef SM4_MODES_H
+#define SM4_MODES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sm4.h"
+
+// 分组密码工作模式。可并行的方向（ECB、CBC 解密、CFB 解密、CTR、XTS）每次把一批分组交给
+// sm4_encrypt_blocks / sm4_ctr32_encrypt_blocks，由当前 SIMD 后端按 4/8/16 路处理；
+// CBC/CFB 加密和 OFB 存在链式依赖，只能逐分组进行。所有函数的 out 都可以等于 in。
+
+// ECB：nblocks 个分组，加密传入加密密钥，解密传入 sm4_set_decrypt_key 得到的解密密钥
+void sm4_ecb_encrypt(const sm4_ctx *ctx, const uint8_t *in, uint8_t *out, size_t nblocks);
+
+// CBC：iv 在返回时更新为最后一个密文分组，可直接用于下一次调用
+void sm4_cbc_encrypt(const sm4_ctx *ctx, uint8_t iv[BLOCK_SIZE], const uint8_t *in, uint8_t *out, size_t nblocks);
+// ctx 为解密密钥
+void sm4_cbc_decrypt(const sm4_ctx *ctx, uint8_t iv[BLOCK_SIZE], const uint8_t *in, uint8_t *out, size_t nblocks);
+
+// CFB（128 位反馈）与 OFB：len 为字节数，两个方向都使用加密密钥。
+// iv 更新为下一分组的反馈值；len 不是 16 的倍数时，该次调用只能是消息的最后一段
+void sm4_cfb_encrypt(const sm4_ctx *ctx, uint8_t iv[BLOCK_SIZE], const uint8_t *in, uint8_t *out, size_t len);
+void sm4_cfb_decrypt(const sm4_ctx *ctx, uint8_t iv[BLOCK_SIZE], const uint8_t *in, uint8_t *out, size_t len);
+void sm4_ofb_crypt(const sm4_ctx *ctx, uint8_t iv[BLOCK_SIZE], const uint8_t *in, uint8_t *out, size_t len);
+
+// CTR（128 位大端计数器，与 OpenSSL 的 SM4-CTR 一致）：加解密相同。
+// counter 更新为下一个未使用的计数器分组（不足一个分组的尾部也消耗一个）
+void sm4_ctr_crypt(const sm4_ctx *ctx, uint8_t counter[BLOCK_SIZE], const uint8_t *in, uint8_t *out, size_t len);
+
+// XTS（IEEE 1619，密文窃取）：256 位密钥 = 数据密钥 K1 || 调整值密钥 K2，tweak 通常为扇区号。
+// 注意 GB/T 17964-2021 的 XTS 调整值乘法按大端比特序，与本实现（IEEE）的密文在第二个分组起不同
+typedef struct {
+    sm4_ctx data;       // K1，加密或解密密钥
+    sm4_ctx tweak;      // K2，始终为加密密钥
+} sm4_xts_key;
+
+void sm4_xts_set_key(sm4_xts_key *key, const uint8_t raw[2 * BLOCK_SIZE], int encrypt);
+// len 至少 16 字节，否则返回 -1；成功返回 0
+int sm4_xts_encrypt(const sm4_xts_key *key, const uint8_t tweak[BLOCK_SIZE], const uint8_t *in, uint8_t *out, size_t len);
+int sm4_xts_decrypt(const sm4_xts_key *key, const uint8_t tweak[BLOCK_SIZE], const uint8_t *in, uint8_t *out, size_t len);
+
+#endif
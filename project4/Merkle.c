@@ -4,133 +4,47 @@
 #include <stdint.h>
 #include <time.h>
 #include <assert.h>
+#include <pthread.h>
+#include <unistd.h>
 
-// ====================== SM3 哈希算法实现 ======================
-#define ROTL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
-
-static const uint32_t T[64] = {
-    0x79CC4519, 0x79CC4519, 0x79CC4519, 0x79CC4519, 0x79CC4519, 0x79CC4519, 0x79CC4519, 0x79CC4519,
-    0x79CC4519, 0x79CC4519, 0x79CC4519, 0x79CC4519, 0x79CC4519, 0x79CC4519, 0x79CC4519, 0x79CC4519,
-    0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A,
-    0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A,
-    0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A,
-    0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A,
-    0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A
-};
-
-#define FF0(x, y, z) ((x) ^ (y) ^ (z))
-#define GG0(x, y, z) ((x) ^ (y) ^ (z))
-#define FF1(x, y, z) (((x) & (y)) | ((x) & (z)) | ((y) & (z)))
-#define GG1(x, y, z) (((x) & (y)) | ((~(x)) & (z)))
-
-#define P0(x) ((x) ^ ROTL(x, 9) ^ ROTL(x, 17))
-#define P1(x) ((x) ^ ROTL(x, 15) ^ ROTL(x, 23))
-
-void sm3_pad(const uint8_t *msg, size_t len, uint8_t **out, size_t *out_len) {
-    size_t blocks = (len + 1 + 8 + 63) / 64;
-    *out_len = blocks * 64;
-    *out = (uint8_t *)malloc(*out_len);
-    memset(*out, 0, *out_len);
-    memcpy(*out, msg, len);
-    (*out)[len] = 0x80;
-
-    uint64_t bit_len = (uint64_t)len * 8;
-    for (int i = 0; i < 8; i++) {
-        (*out)[*out_len - 8 + i] = (bit_len >> (56 - i * 8)) & 0xFF;
-    }
-}
-
-void sm3_expand(const uint8_t block[64], uint32_t W[68], uint32_t W1[64]) {
-    for (int i = 0; i < 16; i++) {
-        W[i] = ((uint32_t)block[i * 4] << 24) |
-               ((uint32_t)block[i * 4 + 1] << 16) |
-               ((uint32_t)block[i * 4 + 2] << 8) |
-               block[i * 4 + 3];
-    }
-    for (int i = 16; i < 68; i++) {
-        W[i] = P1(W[i - 16] ^ W[i - 9] ^ ROTL(W[i - 3], 15)) ^ 
-               ROTL(W[i - 13], 7) ^ W[i - 6];
-    }
-    for (int i = 0; i < 64; i++) {
-        W1[i] = W[i] ^ W[i + 4];
-    }
-}
-
-void sm3_compress(uint32_t state[8], const uint32_t W[68], const uint32_t W1[64]) {
-    uint32_t A = state[0], B = state[1], C = state[2], D = state[3];
-    uint32_t E = state[4], F = state[5], G = state[6], H = state[7];
-
-    for (int j = 0; j < 64; j++) {
-        uint32_t SS1 = ROTL((ROTL(A, 12) + E + ROTL(T[j], j)), 7);
-        uint32_t SS2 = SS1 ^ ROTL(A, 12);
-        uint32_t TT1 = (j < 16) ? FF0(A, B, C) + D + SS2 + W1[j] : 
-                                 FF1(A, B, C) + D + SS2 + W1[j];
-        uint32_t TT2 = (j < 16) ? GG0(E, F, G) + H + SS1 + W[j] : 
-                                 GG1(E, F, G) + H + SS1 + W[j];
-        D = C; 
-        C = ROTL(B, 9); 
-        B = A; 
-        A = TT1;
-        H = G; 
-        G = ROTL(F, 19); 
-        F = E; 
-        E = P0(TT2);
-    }
-
-    state[0] ^= A; 
-    state[1] ^= B; 
-    state[2] ^= C; 
-    state[3] ^= D;
-    state[4] ^= E; 
-    state[5] ^= F; 
-    state[6] ^= G; 
-    state[7] ^= H;
-}
+#include "sm3.h"
+#include "sm3_mb.h"
 
-void sm3_hash(const uint8_t *msg, size_t len, uint8_t digest[32]) {
-    uint32_t state[8] = {
-        0x7380166F, 0x4914B2B9, 0x172442D7, 0xDA8A0600,
-        0xA96F30BC, 0x163138AA, 0xE38DEE4D, 0xB0FB0E4E
-    };
-
-    uint8_t *padded_msg;
-    size_t padded_len;
-    sm3_pad(msg, len, &padded_msg, &padded_len);
-
-    size_t blocks = padded_len / 64;
-    for (size_t i = 0; i < blocks; i++) {
-        uint32_t W[68], W1[64];
-        sm3_expand(padded_msg + i * 64, W, W1);
-        sm3_compress(state, W, W1);
-    }
+// ====================== Merkle 树实现 ======================
 
-    for (int i = 0; i < 8; i++) {
-        digest[i * 4] = (state[i] >> 24) & 0xFF;
-        digest[i * 4 + 1] = (state[i] >> 16) & 0xFF;
-        digest[i * 4 + 2] = (state[i] >> 8) & 0xFF;
-        digest[i * 4 + 3] = state[i] & 0xFF;
-    }
+// Merkle树：按层连续存放的节点哈希，一次分配
+// 第 0 层是叶子，第 h+1 层的节点 i 由第 h 层的节点 2i、2i+1 计算；
+// 某层节点数为奇数时，最后一个节点不做哈希、原样升到上一层。
+// 这样得到的根就是 RFC 6962 的 MTH（在小于 n 的最大 2 的幂处划分左右子树，不复制节点）：
+// 左边每个完整的 2^h 子树都按层成对计算，右边剩余部分的根逐层上移，直到与左边配对
+// 子节点、兄弟节点全部由下标计算得到，不存指针；整棵树用一次 free 释放
+#define MERKLE_MAX_LEVELS 65
 
-    free(padded_msg);
+typedef struct {
+    size_t leaf_count;                          // 叶子数
+    size_t level_count;                         // 层数（含叶子层和根）
+    size_t level_offset[MERKLE_MAX_LEVELS];     // 每层在 hashes 中的起始位置
+    size_t level_size[MERKLE_MAX_LEVELS];       // 每层节点数
+    uint8_t hashes[][32];                       // 所有节点哈希，按层从叶子到根排列
+} MerkleTree;
+
+// 第 h 层第 0 个节点的哈希
+static inline uint8_t (*merkle_level(const MerkleTree *tree, size_t h))[32] {
+    return (uint8_t (*)[32])tree->hashes[tree->level_offset[h]];
 }
 
-// ====================== Merkle 树实现 ======================
-
-// Merkle树节点结构
-typedef struct MerkleNode {
-    uint8_t hash[32];          // 节点哈希值
-    struct MerkleNode *left;   // 左子节点
-    struct MerkleNode *right;  // 右子节点
-    size_t start_index;        // 包含的叶子起始索引
-    size_t end_index;          // 包含的叶子结束索引
-} MerkleNode;
+// 根哈希
+static inline const uint8_t *merkle_root(const MerkleTree *tree) {
+    return tree->hashes[tree->level_offset[tree->level_count - 1]];
+}
 
-// 存在性证明结构
+// 存在性证明结构（RFC 6962 审计路径）
+// 兄弟节点的左右由 index 和 tree_size 决定，不单独存放，与 Certificate Transparency 的验证方式相同
 typedef struct {
     size_t index;              // 叶子索引
+    size_t tree_size;          // 树的叶子数
     uint8_t leaf_hash[32];     // 叶子哈希值
-    uint8_t **sibling_hashes;  // 路径上的兄弟节点哈希
-    int *is_right_sibling;     // 兄弟节点是否为右节点 (0=左,1=右)
+    uint8_t (*sibling_hashes)[32]; // 路径上的兄弟节点哈希，从叶子到根
     size_t path_length;        // 路径长度
 } InclusionProof;
 
@@ -142,159 +56,263 @@ typedef struct {
     InclusionProof *upper_proof; // 上界存在性证明
 } ExclusionProof;
 
+// 一致性证明结构（RFC 6962 2.1.2）：证明 old_size 个叶子的树是 new_size 个叶子的树的前缀
+typedef struct {
+    size_t old_size;           // 旧树叶子数 m
+    size_t new_size;           // 新树叶子数 n
+    uint8_t (*hashes)[32];     // 证明中的子树哈希
+    size_t length;             // 哈希个数
+} ConsistencyProof;
+
 // 计算叶子节点的哈希（带RFC6962前缀）
 void compute_leaf_hash(const uint8_t *data, size_t len, uint8_t hash[32]) {
-    uint8_t input[len + 1];
-    input[0] = 0x00; // RFC6962叶子节点前缀
-    memcpy(input + 1, data, len);
-    sm3_hash(input, len + 1, hash);
+    static const uint8_t prefix = 0x00; // RFC6962叶子节点前缀
+    sm3_ctx ctx;
+    sm3_init(&ctx);
+    sm3_update(&ctx, &prefix, 1);
+    sm3_update(&ctx, data, len);
+    sm3_final(&ctx, hash);
 }
 
 // 计算内部节点的哈希（带RFC6962前缀）
 void compute_internal_hash(const uint8_t *left_hash, const uint8_t *right_hash, uint8_t parent_hash[32]) {
     uint8_t input[65];
     input[0] = 0x01; // RFC6962内部节点前缀
-    
-    // 如果右节点为空，则复制左节点
-    if (right_hash == NULL) {
-        memcpy(input + 1, left_hash, 32);
-        memcpy(input + 33, left_hash, 32);
-    } else {
-        memcpy(input + 1, left_hash, 32);
-        memcpy(input + 33, right_hash, 32);
-    }
-    
+    memcpy(input + 1, left_hash, 32);
+    memcpy(input + 33, right_hash, 32);
     sm3_hash(input, 65, parent_hash);
 }
 
-// 递归构建Merkle树
-MerkleNode* build_merkle_tree_level(uint8_t **leaf_hashes, size_t start, size_t end) {
-    MerkleNode *node = (MerkleNode*)malloc(sizeof(MerkleNode));
-    node->start_index = start;
-    node->end_index = end;
-    
-    // 叶子节点
-    if (start == end) {
-        memcpy(node->hash, leaf_hashes[start], 32);
-        node->left = NULL;
-        node->right = NULL;
-        return node;
+// RFC 6962 MTH 的递归定义，逐个调用 compute_internal_hash，用于校验按层构建的结果
+// n > 1 时 k 为小于 n 的最大 2 的幂：MTH(D[n]) = H(0x01 || MTH(D[0:k]) || MTH(D[k:n]))
+void compute_mth(const uint8_t (*leaf_hashes)[32], size_t n, uint8_t hash[32]) {
+    if (n == 1) {
+        memcpy(hash, leaf_hashes[0], 32);
+        return;
+    }
+    size_t k = 1;
+    while (k * 2 < n) {
+        k *= 2;
+    }
+    uint8_t left[32], right[32];
+    compute_mth(leaf_hashes, k, left);
+    compute_mth(leaf_hashes + k, n - k, right);
+    compute_internal_hash(left, right, hash);
+}
+
+// 分配树：先计算各层大小，树头与全部节点一次分配，叶子层直接复制进去
+static MerkleTree* merkle_tree_alloc(const uint8_t (*leaf_hashes)[32], size_t leaf_count) {
+    size_t level_size[MERKLE_MAX_LEVELS];
+    size_t level_count = 0;
+    size_t total = 0;
+    size_t n = leaf_count;
+    while (1) {
+        level_size[level_count++] = n;
+        total += n;
+        if (n == 1) {
+            break;
+        }
+        n = (n + 1) / 2;
     }
     
-    // 内部节点
-    size_t mid = start + (end - start) / 2;
-    node->left = build_merkle_tree_level(leaf_hashes, start, mid);
-    node->right = build_merkle_tree_level(leaf_hashes, mid + 1, end);
-    
-    // 计算当前节点哈希
-    compute_internal_hash(node->left->hash, 
-                         (node->right ? node->right->hash : NULL), 
-                         node->hash);
+    MerkleTree *tree = (MerkleTree*)malloc(sizeof(MerkleTree) + total * 32);
+    tree->leaf_count = leaf_count;
+    tree->level_count = level_count;
+    size_t offset = 0;
+    for (size_t h = 0; h < level_count; h++) {
+        tree->level_offset[h] = offset;
+        tree->level_size[h] = level_size[h];
+        offset += level_size[h];
+    }
+    memcpy(merkle_level(tree, 0), leaf_hashes, leaf_count * 32);
+    return tree;
+}
+
+#define MERKLE_HASH_CHUNK 1024        // 每次交给 sm3_hash_batch_65 的节点对数
+
+// 计算第 h_begin+1 .. h_end 层中覆盖叶子 [lo, hi) 的节点。lo 按 2^h_end 对齐，hi 也对齐或等于叶子数，
+// 因此各层的范围互不交叉，成对的节点不会跨越范围边界，不同范围可以并行计算。
+// 成对的节点每次取 MERKLE_HASH_CHUNK 对拼成 0x01 || 左 || 右 的 65 字节输入交给 sm3_hash_batch_65，
+// 输入缓冲区在栈上、大小固定，不随树的规模增长
+static void merkle_hash_levels(MerkleTree *tree, size_t h_begin, size_t h_end, size_t lo, size_t hi) {
+    uint8_t input[MERKLE_HASH_CHUNK][65];
+    for (size_t h = h_begin + 1; h <= h_end; h++) {
+        size_t child_lo = lo >> (h - 1);
+        size_t child_hi = (hi + ((size_t)1 << (h - 1)) - 1) >> (h - 1);
+        uint8_t (*child)[32] = merkle_level(tree, h - 1) + child_lo;
+        uint8_t (*parent)[32] = merkle_level(tree, h) + child_lo / 2;
+        size_t child_size = child_hi - child_lo;
+        size_t pairs = child_size / 2;
+        for (size_t base = 0; base < pairs; base += MERKLE_HASH_CHUNK) {
+            size_t n = pairs - base < MERKLE_HASH_CHUNK ? pairs - base : MERKLE_HASH_CHUNK;
+            for (size_t i = 0; i < n; i++) {
+                input[i][0] = 0x01; // RFC6962内部节点前缀
+                memcpy(input[i] + 1, child[2 * (base + i)], 32);
+                memcpy(input[i] + 33, child[2 * (base + i) + 1], 32);
+            }
+            sm3_hash_batch_65(input, parent + base, n);
+        }
+        if (child_size & 1) {
+            // 没有右兄弟的节点原样上移（只可能是该层最后一个节点）
+            memcpy(parent[pairs], child[child_size - 1], 32);
+        }
+    }
+}
+
+// 构建完整的Merkle树：逐层计算，每层的所有节点互不依赖，分块批量计算
+MerkleTree* build_merkle_tree(const uint8_t (*leaf_hashes)[32], size_t leaf_count) {
+    if (leaf_count == 0) {
+        return NULL;
+    }
     
-    return node;
+    MerkleTree *tree = merkle_tree_alloc(leaf_hashes, leaf_count);
+    merkle_hash_levels(tree, 0, tree->level_count - 1, 0, leaf_count);
+    return tree;
 }
 
-// 构建完整的Merkle树
-MerkleNode* build_merkle_tree(uint8_t **leaf_hashes, size_t leaf_count) {
-    return build_merkle_tree_level(leaf_hashes, 0, leaf_count - 1);
+// ---------- 多线程构建 ----------
+#define MERKLE_MT_MAX_THREADS 64
+#define MERKLE_MT_MIN_LEAVES 8192       // 每个线程至少处理的叶子数，太少时线程开销超过收益
+#define MERKLE_MT_CHUNKS_PER_THREAD 8   // 每个线程分到的完整子树数，越多负载越均衡
+
+typedef struct {
+    MerkleTree *tree;
+    size_t height;              // 子树高度：计算第 1..height 层
+    size_t lo, hi;              // 叶子范围
+} merkle_mt_job;
+
+static void* merkle_mt_worker(void *arg) {
+    merkle_mt_job *job = (merkle_mt_job*)arg;
+    merkle_hash_levels(job->tree, 0, job->height, job->lo, job->hi);
+    return NULL;
 }
 
-// 生成存在性证明
-InclusionProof* generate_inclusion_proof(MerkleNode *root, size_t index) {
-    if (index < root->start_index || index > root->end_index) {
-        return NULL; // 索引超出范围
+// 多线程构建，结果与 build_merkle_tree 逐字节相同：
+// 叶子按 2^s 分成完整子树，每个线程负责连续的若干棵，在共享的按层存储中直接写各自的节点范围，互不加锁；
+// 所有线程结束后，主线程计算第 s 层以上剩下的少数几层。每个线程内部仍是逐层批量 SM3
+MerkleTree* build_merkle_tree_mt(const uint8_t (*leaf_hashes)[32], size_t leaf_count, int nthreads) {
+    // 先处理 0 和负数，否则下面转成 size_t 比较时会变成极大值，越过 MERKLE_MT_MAX_THREADS 的上限
+    if (nthreads < 1) {
+        nthreads = 1;
+    }
+    if (nthreads > MERKLE_MT_MAX_THREADS) {
+        nthreads = MERKLE_MT_MAX_THREADS;
+    }
+    if ((size_t)nthreads > leaf_count / MERKLE_MT_MIN_LEAVES) {
+        nthreads = (int)(leaf_count / MERKLE_MT_MIN_LEAVES);
+    }
+    if (nthreads <= 1) {
+        return build_merkle_tree(leaf_hashes, leaf_count);
     }
     
-    InclusionProof *proof = (InclusionProof*)malloc(sizeof(InclusionProof));
-    proof->index = index;
+    MerkleTree *tree = merkle_tree_alloc(leaf_hashes, leaf_count);
     
-    // 存储叶子哈希
-    proof->path_length = 0;
-    size_t max_depth = 64; // 足够大的初始值
-    proof->sibling_hashes = (uint8_t**)malloc(max_depth * sizeof(uint8_t*));
-    proof->is_right_sibling = (int*)malloc(max_depth * sizeof(int));
-    
-    MerkleNode *current = root;
-    MerkleNode *path[64]; // 存储路径节点
-    int path_direction[64]; // 0=左,1=右
-    size_t path_index = 0;
-    
-    // 遍历到叶子节点
-    while (current->left || current->right) {
-        path[path_index] = current;
-        
-        if (index <= current->left->end_index) {
-            // 向左子树
-            current = current->left;
-            path_direction[path_index] = 0; // 当前是左节点
+    // 子树大小取不超过 leaf_count / (线程数 × 每线程子树数) 的最大 2 的幂
+    size_t height = 0;
+    while (((size_t)2 << height) <= leaf_count / ((size_t)nthreads * MERKLE_MT_CHUNKS_PER_THREAD)) {
+        height++;
+    }
+    size_t chunk = (size_t)1 << height;
+    size_t chunks = (leaf_count + chunk - 1) / chunk;
+    
+    merkle_mt_job jobs[MERKLE_MT_MAX_THREADS];
+    pthread_t tids[MERKLE_MT_MAX_THREADS];
+    int started[MERKLE_MT_MAX_THREADS];
+    for (int i = 0; i < nthreads; i++) {
+        size_t c0 = chunks * i / nthreads;
+        size_t c1 = chunks * (i + 1) / nthreads;
+        jobs[i].tree = tree;
+        jobs[i].height = height;
+        jobs[i].lo = c0 * chunk;
+        jobs[i].hi = c1 * chunk < leaf_count ? c1 * chunk : leaf_count;
+    }
+    
+    // 主线程自己处理最后一段，线程创建失败时也在主线程中补做
+    for (int i = 0; i < nthreads - 1; i++) {
+        started[i] = pthread_create(&tids[i], NULL, merkle_mt_worker, &jobs[i]) == 0;
+    }
+    merkle_mt_worker(&jobs[nthreads - 1]);
+    for (int i = 0; i < nthreads - 1; i++) {
+        if (started[i]) {
+            pthread_join(tids[i], NULL);
         } else {
-            // 向右子树
-            current = current->right;
-            path_direction[path_index] = 1; // 当前是右节点
+            merkle_mt_worker(&jobs[i]);
         }
-        path_index++;
     }
     
-    // 存储叶子哈希
-    memcpy(proof->leaf_hash, current->hash, 32);
+    // 第 height 层只剩 chunks 个节点
+    merkle_hash_levels(tree, height, tree->level_count - 1, 0, leaf_count);
+    return tree;
+}
+
+// 生成存在性证明：从叶子层向上，每层的兄弟节点下标为 i ^ 1；
+// 原样上移的节点在该层没有兄弟，不进入路径（即 RFC 6962 的 PATH(m, D[n])）
+InclusionProof* generate_inclusion_proof(const MerkleTree *tree, size_t index) {
+    if (index >= tree->leaf_count) {
+        return NULL; // 索引超出范围
+    }
     
-    // 回溯路径收集兄弟节点哈希
-    for (int i = path_index - 1; i >= 0; i--) {
-        MerkleNode *node = path[i];
-        
-        if (path_direction[i] == 0) {
-            // 当前是左节点，兄弟是右节点
-            if (node->right) {
-                proof->sibling_hashes[proof->path_length] = (uint8_t*)malloc(32);
-                memcpy(proof->sibling_hashes[proof->path_length], node->right->hash, 32);
-                proof->is_right_sibling[proof->path_length] = 1;
-            } else {
-                // 如果没有右兄弟，使用左兄弟（树不平衡）
-                proof->sibling_hashes[proof->path_length] = (uint8_t*)malloc(32);
-                memcpy(proof->sibling_hashes[proof->path_length], node->left->hash, 32);
-                proof->is_right_sibling[proof->path_length] = 0;
-            }
-        } else {
-            // 当前是右节点，兄弟是左节点
-            proof->sibling_hashes[proof->path_length] = (uint8_t*)malloc(32);
-            memcpy(proof->sibling_hashes[proof->path_length], node->left->hash, 32);
-            proof->is_right_sibling[proof->path_length] = 0;
+    InclusionProof *proof = (InclusionProof*)malloc(sizeof(InclusionProof));
+    proof->index = index;
+    proof->tree_size = tree->leaf_count;
+    memcpy(proof->leaf_hash, merkle_level(tree, 0)[index], 32);
+    proof->sibling_hashes = malloc(tree->level_count * sizeof(*proof->sibling_hashes));
+    proof->path_length = 0;
+    
+    size_t i = index;
+    for (size_t h = 0; h + 1 < tree->level_count; h++) {
+        size_t sibling = i ^ 1;
+        if (sibling < tree->level_size[h]) {
+            memcpy(proof->sibling_hashes[proof->path_length++], merkle_level(tree, h)[sibling], 32);
         }
-        
-        proof->path_length++;
+        i >>= 1;
     }
     
     return proof;
 }
 
-// 验证存在性证明
+// 验证存在性证明（RFC 9162 2.1.3.2）：fn、sn 是当前节点与最后一个节点在本层的下标，
+// fn 为奇数或等于 sn 时兄弟在左边；fn 为偶数且等于 sn 时该节点在若干层上原样上移，一并跳过
 int verify_inclusion(const uint8_t *root_hash, InclusionProof *proof) {
+    if (proof->index >= proof->tree_size) {
+        return 0;
+    }
+    
+    size_t fn = proof->index;
+    size_t sn = proof->tree_size - 1;
     uint8_t current_hash[32];
     memcpy(current_hash, proof->leaf_hash, 32);
     
     for (size_t i = 0; i < proof->path_length; i++) {
-        uint8_t parent_hash[32];
+        if (sn == 0) {
+            return 0; // 路径比树高还长
+        }
         
-        if (proof->is_right_sibling[i]) {
-            // 兄弟是右节点，当前是左节点
-            compute_internal_hash(current_hash, proof->sibling_hashes[i], parent_hash);
-        } else {
+        if ((fn & 1) || fn == sn) {
             // 兄弟是左节点，当前是右节点
-            compute_internal_hash(proof->sibling_hashes[i], current_hash, parent_hash);
+            compute_internal_hash(proof->sibling_hashes[i], current_hash, current_hash);
+            while (!(fn & 1) && fn != 0) {
+                fn >>= 1;
+                sn >>= 1;
+            }
+        } else {
+            // 兄弟是右节点，当前是左节点
+            compute_internal_hash(current_hash, proof->sibling_hashes[i], current_hash);
         }
-        
-        memcpy(current_hash, parent_hash, 32);
+        fn >>= 1;
+        sn >>= 1;
     }
     
-    return memcmp(current_hash, root_hash, 32) == 0;
+    return sn == 0 && memcmp(current_hash, root_hash, 32) == 0;
 }
 
 // 生成不存在性证明
-ExclusionProof* generate_exclusion_proof(MerkleNode *root, uint8_t *target_hash, uint8_t **leaf_hashes, size_t leaf_count) {
-    // 在叶子哈希中查找目标位置（假设叶子已排序）
+ExclusionProof* generate_exclusion_proof(const MerkleTree *tree, uint8_t *target_hash) {
+    // 在叶子层中查找目标位置（假设叶子已排序）
+    uint8_t (*leaf_hashes)[32] = merkle_level(tree, 0);
+    size_t leaf_count = tree->leaf_count;
     size_t lower_bound = 0;
     size_t upper_bound = leaf_count - 1;
-    int found = 0;
     
     // 二分查找目标位置
     while (lower_bound <= upper_bound) {
@@ -305,6 +323,9 @@ ExclusionProof* generate_exclusion_proof(MerkleNode *root, uint8_t *target_hash,
             // 目标存在，不能生成不存在证明
             return NULL;
         } else if (cmp < 0) {
+            if (mid == 0) {
+                break; // 目标小于第一个叶子，upper_bound 不能再减
+            }
             upper_bound = mid - 1;
         } else {
             lower_bound = mid + 1;
@@ -329,8 +350,8 @@ ExclusionProof* generate_exclusion_proof(MerkleNode *root, uint8_t *target_hash,
     }
     
     // 生成边界的存在性证明
-    proof->lower_proof = generate_inclusion_proof(root, proof->lower_bound);
-    proof->upper_proof = generate_inclusion_proof(root, proof->upper_bound);
+    proof->lower_proof = generate_inclusion_proof(tree, proof->lower_bound);
+    proof->upper_proof = generate_inclusion_proof(tree, proof->upper_bound);
     
     return proof;
 }
@@ -360,26 +381,120 @@ int verify_exclusion(const uint8_t *root_hash, ExclusionProof *proof, uint8_t *t
     }
 }
 
-// 释放Merkle树内存
-void free_merkle_tree(MerkleNode *node) {
-    if (!node) return;
+// 第 0 层下标 start 开始、size 个叶子的子树哈希：start 必须按 2^ceil(log2 size) 对齐，
+// 且子树要么完整（size 是 2 的幂），要么延伸到最后一个叶子，此时它就是第 h 层第 start >> h 个节点
+static const uint8_t *merkle_subtree(const MerkleTree *tree, size_t start, size_t size) {
+    size_t h = 0;
+    while (((size_t)1 << h) < size) {
+        h++;
+    }
+    assert((start & (((size_t)1 << h) - 1)) == 0);
+    assert(size == ((size_t)1 << h) || start + size == tree->leaf_count);
+    return merkle_level(tree, h)[start >> h];
+}
+
+// RFC 6962 的 SUBPROOF(m, D[start:start+n], b)，结果按顺序追加到 proof->hashes
+static void consistency_subproof(const MerkleTree *tree, ConsistencyProof *proof, size_t m, size_t start, size_t n, int b) {
+    if (m == n) {
+        if (!b) {
+            memcpy(proof->hashes[proof->length++], merkle_subtree(tree, start, n), 32);
+        }
+        return;
+    }
+    size_t k = 1;
+    while (k * 2 < n) {
+        k *= 2;
+    }
+    if (m <= k) {
+        consistency_subproof(tree, proof, m, start, k, b);
+        memcpy(proof->hashes[proof->length++], merkle_subtree(tree, start + k, n - k), 32);
+    } else {
+        consistency_subproof(tree, proof, m - k, start + k, n - k, 0);
+        memcpy(proof->hashes[proof->length++], merkle_subtree(tree, start, k), 32);
+    }
+}
+
+// 生成一致性证明：新树就是 tree（new_size = tree->leaf_count），0 < old_size <= new_size。
+// 证明中的每个哈希都是新树里已存的节点，直接按下标取出，不重算叶子，O(log n)
+ConsistencyProof* generate_consistency_proof(const MerkleTree *tree, size_t old_size) {
+    if (old_size == 0 || old_size > tree->leaf_count) {
+        return NULL;
+    }
     
-    if (node->left) free_merkle_tree(node->left);
-    if (node->right) free_merkle_tree(node->right);
+    ConsistencyProof *proof = (ConsistencyProof*)malloc(sizeof(ConsistencyProof));
+    proof->old_size = old_size;
+    proof->new_size = tree->leaf_count;
+    proof->hashes = malloc(2 * tree->level_count * sizeof(*proof->hashes));
+    proof->length = 0;
+    consistency_subproof(tree, proof, old_size, 0, tree->leaf_count, 1);
+    return proof;
+}
+
+// 验证一致性证明（RFC 9162 2.1.4.2）：同一条路径同时重算旧根 fr 和新根 fh
+int verify_consistency(const uint8_t *old_root, const uint8_t *new_root, ConsistencyProof *proof) {
+    size_t m = proof->old_size;
+    size_t n = proof->new_size;
+    if (m == 0 || m > n) {
+        return 0;
+    }
+    if (m == n) {
+        return proof->length == 0 && memcmp(old_root, new_root, 32) == 0;
+    }
+    if (proof->length == 0) {
+        return 0;
+    }
+    
+    // 旧树是完整子树时，它自己的根就是路径的第一个节点，证明中省略
+    size_t i = 0;
+    uint8_t fr[32], fh[32];
+    if ((m & (m - 1)) == 0) {
+        memcpy(fr, old_root, 32);
+    } else {
+        memcpy(fr, proof->hashes[i++], 32);
+    }
+    memcpy(fh, fr, 32);
+    
+    size_t fn = m - 1;
+    size_t sn = n - 1;
+    while (fn & 1) {
+        fn >>= 1;
+        sn >>= 1;
+    }
     
-    free(node);
+    for (; i < proof->length; i++) {
+        if (sn == 0) {
+            return 0; // 路径比树高还长
+        }
+        
+        if ((fn & 1) || fn == sn) {
+            // 兄弟在左边：旧根和新根都要合并
+            compute_internal_hash(proof->hashes[i], fr, fr);
+            compute_internal_hash(proof->hashes[i], fh, fh);
+            while (!(fn & 1) && fn != 0) {
+                fn >>= 1;
+                sn >>= 1;
+            }
+        } else {
+            // 兄弟在右边：只属于新树
+            compute_internal_hash(fh, proof->hashes[i], fh);
+        }
+        fn >>= 1;
+        sn >>= 1;
+    }
+    
+    return sn == 0 && memcmp(fr, old_root, 32) == 0 && memcmp(fh, new_root, 32) == 0;
+}
+
+// 释放Merkle树内存：节点与树头在同一块内存中
+void free_merkle_tree(MerkleTree *tree) {
+    free(tree);
 }
 
 // 释放存在性证明内存
 void free_inclusion_proof(InclusionProof *proof) {
     if (!proof) return;
     
-    for (size_t i = 0; i < proof->path_length; i++) {
-        free(proof->sibling_hashes[i]);
-    }
-    
     free(proof->sibling_hashes);
-    free(proof->is_right_sibling);
     free(proof);
 }
 
@@ -393,6 +508,61 @@ void free_exclusion_proof(ExclusionProof *proof) {
     free(proof);
 }
 
+// 释放一致性证明内存
+void free_consistency_proof(ConsistencyProof *proof) {
+    if (!proof) return;
+    
+    free(proof->hashes);
+    free(proof);
+}
+
+// ====================== 追加式 Merkle 日志 ======================
+
+// 只保存右边界（compact range）：size 的第 h 位为 1 时，frontier[h] 是一棵 2^h 叶子的完整子树的根，
+// 这些子树从左到右（高位到低位）恰好覆盖全部叶子。按 RFC 6962 的划分，左边的完整子树以后不会再变化，
+// 所以追加叶子不需要保存或重算旧叶子
+typedef struct {
+    uint64_t size;                          // 已追加的叶子数
+    uint8_t frontier[MERKLE_MAX_LEVELS][32]; // 各完整子树的根
+} MerkleLog;
+
+void merkle_log_init(MerkleLog *log) {
+    log->size = 0;
+}
+
+// 追加一个叶子哈希：与二进制加一的进位相同，低位连续的 1 逐个合并，
+// 最坏 O(log n) 次 SM3，均摊每次不到 1 次
+void merkle_log_append(MerkleLog *log, const uint8_t leaf_hash[32]) {
+    uint8_t node[32];
+    memcpy(node, leaf_hash, 32);
+    int h = 0;
+    while ((log->size >> h) & 1) {
+        compute_internal_hash(log->frontier[h], node, node);
+        h++;
+    }
+    memcpy(log->frontier[h], node, 32);
+    log->size++;
+}
+
+// 当前树根：从最小的子树开始向左合并，O(log n) 次 SM3，不修改日志
+// 空日志的根按 RFC 6962 定义为 SM3 空串
+void merkle_log_root(const MerkleLog *log, uint8_t root[32]) {
+    if (log->size == 0) {
+        sm3_hash((const uint8_t*)"", 0, root);
+        return;
+    }
+    int h = 0;
+    while (!((log->size >> h) & 1)) {
+        h++;
+    }
+    memcpy(root, log->frontier[h], 32);
+    for (h++; h < 64; h++) {
+        if ((log->size >> h) & 1) {
+            compute_internal_hash(log->frontier[h], root, root);
+        }
+    }
+}
+
 // ====================== 测试与验证 ======================
 
 // 生成随机数据
@@ -414,37 +584,49 @@ void print_hash(const uint8_t hash[32]) {
 void test_merkle_tree(size_t leaf_count) {
     printf("===== 测试 Merkle 树 (%zu 个叶子节点) =====\n", leaf_count);
     
-    // 生成叶子节点数据
-    uint8_t **leaf_data = (uint8_t**)malloc(leaf_count * sizeof(uint8_t*));
-    uint8_t **leaf_hashes = (uint8_t**)malloc(leaf_count * sizeof(uint8_t*));
+    // 生成叶子节点数据：数据与哈希都连续存放
+    uint8_t (*leaf_data)[32] = malloc(leaf_count * sizeof(*leaf_data));
+    uint8_t (*leaf_hashes)[32] = malloc(leaf_count * sizeof(*leaf_hashes));
+    uint8_t (*leaf_input)[33] = malloc(leaf_count * sizeof(*leaf_input));
     
     for (size_t i = 0; i < leaf_count; i++) {
-        leaf_data[i] = (uint8_t*)malloc(32);
-        leaf_hashes[i] = (uint8_t*)malloc(32);
-        
         generate_random_data(leaf_data[i], 32);
-        compute_leaf_hash(leaf_data[i], 32, leaf_hashes[i]);
+        leaf_input[i][0] = 0x00; // RFC6962叶子节点前缀
+        memcpy(leaf_input[i] + 1, leaf_data[i], 32);
     }
     
-    // 构建Merkle树
+    // 叶子哈希：定长 33 字节，批量计算
     clock_t start = clock();
-    MerkleNode *root = build_merkle_tree(leaf_hashes, leaf_count);
+    sm3_hash_batch_33(leaf_input, leaf_hashes, leaf_count);
     clock_t end = clock();
+    free(leaf_input);
+    printf("叶子哈希计算完成, 耗时: %.2f ms\n", (double)(end - start) * 1000 / CLOCKS_PER_SEC);
+    
+    // 构建Merkle树
+    start = clock();
+    MerkleTree *tree = build_merkle_tree((const uint8_t (*)[32])leaf_hashes, leaf_count);
+    end = clock();
     
-    printf("Merkle树构建完成, 耗时: %.2f ms\n", (double)(end - start) * 1000 / CLOCKS_PER_SEC);
+    size_t node_count = tree->level_offset[tree->level_count - 1] + 1;
+    printf("Merkle树构建完成, 耗时: %.2f ms, %zu 个节点, 占用 %.1f KB\n", (double)(end - start) * 1000 / CLOCKS_PER_SEC,
+           node_count, (double)(sizeof(MerkleTree) + node_count * 32) / 1024);
     printf("根哈希: ");
-    print_hash(root->hash);
+    print_hash(merkle_root(tree));
+    
+    uint8_t mth[32];
+    compute_mth((const uint8_t (*)[32])leaf_hashes, leaf_count, mth);
+    printf("RFC 6962 MTH 递归校验: %s\n", memcmp(mth, merkle_root(tree), 32) == 0 ? "一致" : "不一致");
     
     // 测试存在性证明
     size_t test_index = rand() % leaf_count;
     start = clock();
-    InclusionProof *inc_proof = generate_inclusion_proof(root, test_index);
+    InclusionProof *inc_proof = generate_inclusion_proof(tree, test_index);
     end = clock();
     
     printf("\n存在性证明生成 (索引 %zu): %.2f ms\n", test_index, (double)(end - start) * 1000 / CLOCKS_PER_SEC);
     
     start = clock();
-    int valid = verify_inclusion(root->hash, inc_proof);
+    int valid = verify_inclusion(merkle_root(tree), inc_proof);
     end = clock();
     
     printf("存在性证明验证: %s, 耗时: %.2f ms\n", valid ? "成功" : "失败", 
@@ -455,7 +637,7 @@ void test_merkle_tree(size_t leaf_count) {
     generate_random_data(target_hash, 32);
     
     start = clock();
-    ExclusionProof *exc_proof = generate_exclusion_proof(root, target_hash, leaf_hashes, leaf_count);
+    ExclusionProof *exc_proof = generate_exclusion_proof(tree, target_hash);
     end = clock();
     
     if (exc_proof) {
@@ -463,7 +645,7 @@ void test_merkle_tree(size_t leaf_count) {
         printf("目标位置: [%zu, %zu]\n", exc_proof->lower_bound, exc_proof->upper_bound);
         
         start = clock();
-        valid = verify_exclusion(root->hash, exc_proof, target_hash);
+        valid = verify_exclusion(merkle_root(tree), exc_proof, target_hash);
         end = clock();
         
         printf("不存在性证明验证: %s, 耗时: %.2f ms\n", valid ? "成功" : "失败", 
@@ -476,14 +658,153 @@ void test_merkle_tree(size_t leaf_count) {
     
     // 清理内存
     free_inclusion_proof(inc_proof);
-    free_merkle_tree(root);
+    free_merkle_tree(tree);
+    
+    free(leaf_data);
+    free(leaf_hashes);
+}
+
+// 测试追加式日志：逐个追加，与按层构建的树根比较，并测量追加与取根的耗时
+void test_merkle_log(size_t leaf_count) {
+    printf("===== 测试追加式 Merkle 日志 (%zu 个叶子节点) =====\n", leaf_count);
     
+    uint8_t (*leaf_hashes)[32] = malloc(leaf_count * sizeof(*leaf_hashes));
+    generate_random_data((uint8_t*)leaf_hashes, leaf_count * 32);
+    
+    // 前 300 个规模逐一比较，之后在 2 的幂附近和最终规模比较
+    MerkleLog log;
+    merkle_log_init(&log);
+    int ok = 1;
+    size_t checked = 0;
     for (size_t i = 0; i < leaf_count; i++) {
-        free(leaf_data[i]);
-        free(leaf_hashes[i]);
+        merkle_log_append(&log, leaf_hashes[i]);
+        size_t n = i + 1;
+        if (n <= 300 || (n & (n - 1)) == 0 || ((n + 1) & n) == 0 || n == leaf_count) {
+            uint8_t root[32];
+            merkle_log_root(&log, root);
+            MerkleTree *tree = build_merkle_tree((const uint8_t (*)[32])leaf_hashes, n);
+            ok &= memcmp(root, merkle_root(tree), 32) == 0;
+            free_merkle_tree(tree);
+            checked++;
+        }
     }
+    printf("日志根与完整建树的根比较 (%zu 个规模): %s\n", checked, ok ? "一致" : "不一致");
     
-    free(leaf_data);
+    clock_t start = clock();
+    merkle_log_init(&log);
+    for (size_t i = 0; i < leaf_count; i++) {
+        merkle_log_append(&log, leaf_hashes[i]);
+    }
+    clock_t end = clock();
+    printf("逐个追加: 平均 %.0f ns/叶子\n", (double)(end - start) * 1e9 / CLOCKS_PER_SEC / leaf_count);
+    
+    uint8_t root[32];
+    start = clock();
+    for (int r = 0; r < 10000; r++) {
+        merkle_log_root(&log, root);
+    }
+    end = clock();
+    printf("取当前树根: %.0f ns\n", (double)(end - start) * 1e9 / CLOCKS_PER_SEC / 10000);
+    printf("根哈希: ");
+    print_hash(root);
+    
+    free(leaf_hashes);
+}
+
+// 测试一致性证明：追加日志时记录若干历史树根（相当于已发布的树头），
+// 再对完整的树生成旧规模到新规模的一致性证明并用记录的树根验证
+void test_consistency_proof(size_t leaf_count) {
+    printf("===== 测试一致性证明 (%zu 个叶子节点) =====\n", leaf_count);
+    
+    enum { HEADS = 64 };
+    uint8_t (*leaf_hashes)[32] = malloc(leaf_count * sizeof(*leaf_hashes));
+    generate_random_data((uint8_t*)leaf_hashes, leaf_count * 32);
+    
+    // 历史规模：1、2 的幂、随机规模和新规模本身
+    size_t old_sizes[HEADS];
+    uint8_t old_roots[HEADS][32];
+    size_t heads = 0;
+    old_sizes[heads++] = 1;
+    for (size_t m = 2; m < leaf_count && heads < HEADS / 2; m *= 2) {
+        old_sizes[heads++] = m;
+    }
+    while (heads < HEADS - 1) {
+        old_sizes[heads++] = 1 + (size_t)rand() % leaf_count;
+    }
+    old_sizes[heads++] = leaf_count;
+    
+    MerkleLog log;
+    merkle_log_init(&log);
+    for (size_t i = 0; i < leaf_count; i++) {
+        merkle_log_append(&log, leaf_hashes[i]);
+        for (size_t j = 0; j < heads; j++) {
+            if (old_sizes[j] == i + 1) {
+                merkle_log_root(&log, old_roots[j]);
+            }
+        }
+    }
+    
+    MerkleTree *tree = build_merkle_tree((const uint8_t (*)[32])leaf_hashes, leaf_count);
+    int ok = 1;
+    size_t max_length = 0;
+    double gen_time = 0, verify_time = 0;
+    for (size_t j = 0; j < heads; j++) {
+        clock_t start = clock();
+        ConsistencyProof *proof = generate_consistency_proof(tree, old_sizes[j]);
+        clock_t mid = clock();
+        ok &= verify_consistency(old_roots[j], merkle_root(tree), proof);
+        clock_t end = clock();
+        gen_time += (double)(mid - start);
+        verify_time += (double)(end - mid);
+        if (proof->length > max_length) {
+            max_length = proof->length;
+        }
+        
+        // 篡改证明中的一个哈希后必须验证失败
+        if (proof->length > 0) {
+            proof->hashes[0][0] ^= 1;
+            ok &= !verify_consistency(old_roots[j], merkle_root(tree), proof);
+        }
+        free_consistency_proof(proof);
+    }
+    
+    printf("%zu 个历史树根的一致性证明验证: %s, 最长 %zu 个哈希\n", heads, ok ? "成功" : "失败", max_length);
+    printf("平均生成 %.2f us, 验证 %.2f us\n", gen_time * 1e6 / CLOCKS_PER_SEC / heads,
+           verify_time * 1e6 / CLOCKS_PER_SEC / heads);
+    
+    free_merkle_tree(tree);
+    free(leaf_hashes);
+}
+
+// 测试多线程构建：与单线程构建的全部节点逐字节比较，并比较耗时
+void test_merkle_tree_mt(size_t leaf_count) {
+    printf("===== 测试多线程构建 (%zu 个叶子节点) =====\n", leaf_count);
+    
+    uint8_t (*leaf_hashes)[32] = malloc(leaf_count * sizeof(*leaf_hashes));
+    generate_random_data((uint8_t*)leaf_hashes, leaf_count * 32);
+    
+    clock_t start = clock();
+    MerkleTree *tree = build_merkle_tree((const uint8_t (*)[32])leaf_hashes, leaf_count);
+    clock_t end = clock();
+    size_t node_count = tree->level_offset[tree->level_count - 1] + 1;
+    printf("单线程: %.2f ms\n", (double)(end - start) * 1000 / CLOCKS_PER_SEC);
+    
+    // 线程数包括 0、负数（按单线程处理）、不整除和超过上限的情况；本机核数放在最后，
+    // clock() 统计所有线程的 CPU 时间，这里用墙钟时间
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    int thread_counts[] = {-1, 0, 2, 3, 7, 16, 100, ncpu > 0 ? (int)ncpu : 1};
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++) {
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        MerkleTree *mt = build_merkle_tree_mt((const uint8_t (*)[32])leaf_hashes, leaf_count, thread_counts[t]);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        int same = memcmp(mt->hashes, tree->hashes, node_count * 32) == 0;
+        printf("%3d 线程: %.2f ms, 与单线程结果%s\n", thread_counts[t],
+               (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6, same ? "一致" : "不一致");
+        free_merkle_tree(mt);
+    }
+    
+    free_merkle_tree(tree);
     free(leaf_hashes);
 }
 
@@ -497,5 +818,9 @@ int main() {
     test_merkle_tree(10000);  // 10,000个叶子节点
     test_merkle_tree(100000); // 100,000个叶子节点
     
+    test_merkle_log(100000);
+    test_consistency_proof(100000);
+    test_merkle_tree_mt(1000000);
+    
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,40 @@
+#ifndef SM3_H
+#define SM3_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SM3_BLOCK_SIZE 64
+#define SM3_DIGEST_SIZE 32
+
+// 流式 SM3 上下文：只缓存不足一个分组的部分，整分组直接从调用者的缓冲区压缩
+typedef struct {
+    uint32_t state[8];
+    uint8_t buf[SM3_BLOCK_SIZE];
+    size_t buf_len;
+    uint64_t total_len;         // 已输入的字节数，final 时换算为比特写入长度字段
+} sm3_ctx;
+
+void sm3_init(sm3_ctx *ctx);
+// 从任意中间状态继续：iv 为已处理 processed_len 字节（必须是 64 的倍数）之后的链接变量。
+// 用于长度扩展演示和预计算的中间状态（如 HMAC 的内外层）
+void sm3_init_from_state(sm3_ctx *ctx, const uint32_t iv[8], uint64_t processed_len);
+void sm3_update(sm3_ctx *ctx, const uint8_t *data, size_t len);
+void sm3_final(sm3_ctx *ctx, uint8_t digest[SM3_DIGEST_SIZE]);
+
+// 一次性接口
+void sm3_hash(const uint8_t *msg, size_t len, uint8_t digest[SM3_DIGEST_SIZE]);
+// 以 iv 为初始状态，按 len 字节的消息长度填充后计算哈希
+void sm3_hash_from_iv(const uint32_t iv[8], const uint8_t *msg, size_t len, uint8_t digest[SM3_DIGEST_SIZE]);
+
+// 分组级接口
+// 轮常量 ROTL(T_j, j mod 32)，供 SIMD 实现广播使用
+extern const uint32_t sm3_T_rotl[64];
+void sm3_expand(const uint8_t block[SM3_BLOCK_SIZE], uint32_t W[68], uint32_t W1[64]);
+void sm3_compress(uint32_t state[8], const uint32_t W[68], const uint32_t W1[64]);
+// 完全展开、消息扩展在轮内进行的压缩函数，结果与 sm3_expand + sm3_compress 相同
+void sm3_compress_unrolled(uint32_t state[8], const uint8_t block[SM3_BLOCK_SIZE]);
+// 连续压缩 nblocks 个 64 字节分组
+void sm3_compress_blocks(uint32_t state[8], const uint8_t *data, size_t nblocks);
+
+#endif
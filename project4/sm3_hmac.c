@@ -0,0 +1,292 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "sm3_hmac.h"
+#include "sm3_mb.h"
+
+static const uint32_t sm3_hmac_iv[8] = {
+    0x7380166F, 0x4914B2B9, 0x172442D7, 0xDA8A0600,
+    0xA96F30BC, 0x163138AA, 0xE38DEE4D, 0xB0FB0E4E
+};
+
+// 通过 volatile 指针逐字节清零：普通 memset 在缓冲区之后不再使用时会被当作死存储删掉
+static void sm3_hmac_wipe(void *buf, size_t len) {
+    volatile uint8_t *p = (volatile uint8_t *)buf;
+    for (size_t i = 0; i < len; i++) {
+        p[i] = 0;
+    }
+}
+
+void sm3_hmac_set_key(sm3_hmac_key *key, const uint8_t *k, size_t klen) {
+    uint8_t block[SM3_BLOCK_SIZE] = {0};
+    if (klen > SM3_BLOCK_SIZE) {
+        sm3_hash(k, klen, block);
+    } else {
+        memcpy(block, k, klen);
+    }
+
+    // K ⊕ ipad 与 K ⊕ opad 各压缩一次，之后只使用压缩后的状态
+    for (int i = 0; i < SM3_BLOCK_SIZE; i++) {
+        block[i] ^= 0x36;
+    }
+    memcpy(key->inner, sm3_hmac_iv, sizeof(key->inner));
+    sm3_compress_blocks(key->inner, block, 1);
+    for (int i = 0; i < SM3_BLOCK_SIZE; i++) {
+        block[i] ^= 0x36 ^ 0x5C;
+    }
+    memcpy(key->outer, sm3_hmac_iv, sizeof(key->outer));
+    sm3_compress_blocks(key->outer, block, 1);
+
+    // block 里是 K ⊕ opad，可以直接还原出密钥，返回前必须擦除
+    sm3_hmac_wipe(block, sizeof(block));
+}
+
+void sm3_hmac_clear_key(sm3_hmac_key *key) {
+    sm3_hmac_wipe(key, sizeof(*key));
+}
+
+// 外层：从 outer 状态压缩 内层摘要(32) || 0x80 || 0...0 || 长度(64+32 字节 = 768 比特)，恰好一个分组
+static void sm3_hmac_outer(const sm3_hmac_key *key, const uint8_t inner[SM3_DIGEST_SIZE], uint8_t mac[SM3_DIGEST_SIZE]) {
+    uint8_t block[SM3_BLOCK_SIZE] = {0};
+    memcpy(block, inner, SM3_DIGEST_SIZE);
+    block[SM3_DIGEST_SIZE] = 0x80;
+    block[SM3_BLOCK_SIZE - 2] = 0x03;   // 768 = 0x0300
+    uint32_t state[8];
+    memcpy(state, key->outer, sizeof(state));
+    sm3_compress_blocks(state, block, 1);
+    for (int i = 0; i < 8; i++) {
+        mac[i * 4] = (state[i] >> 24) & 0xFF;
+        mac[i * 4 + 1] = (state[i] >> 16) & 0xFF;
+        mac[i * 4 + 2] = (state[i] >> 8) & 0xFF;
+        mac[i * 4 + 3] = state[i] & 0xFF;
+    }
+}
+
+void sm3_hmac_init(sm3_hmac_ctx *ctx, const sm3_hmac_key *key) {
+    ctx->key = key;
+    sm3_init_from_state(&ctx->inner, key->inner, SM3_BLOCK_SIZE);
+}
+
+void sm3_hmac_update(sm3_hmac_ctx *ctx, const uint8_t *data, size_t len) {
+    sm3_update(&ctx->inner, data, len);
+}
+
+void sm3_hmac_final(sm3_hmac_ctx *ctx, uint8_t mac[SM3_DIGEST_SIZE]) {
+    uint8_t inner[SM3_DIGEST_SIZE];
+    sm3_final(&ctx->inner, inner);
+    sm3_hmac_outer(ctx->key, inner, mac);
+}
+
+void sm3_hmac(const sm3_hmac_key *key, const uint8_t *msg, size_t len, uint8_t mac[SM3_DIGEST_SIZE]) {
+    sm3_hmac_ctx ctx;
+    sm3_hmac_init(&ctx, key);
+    sm3_hmac_update(&ctx, msg, len);
+    sm3_hmac_final(&ctx, mac);
+}
+
+static int sm3_hmac_equal(const uint8_t a[SM3_DIGEST_SIZE], const uint8_t b[SM3_DIGEST_SIZE]) {
+    uint8_t diff = 0;
+    for (int i = 0; i < SM3_DIGEST_SIZE; i++) {
+        diff |= a[i] ^ b[i];
+    }
+    return diff == 0;
+}
+
+int sm3_hmac_verify(const sm3_hmac_key *key, const uint8_t *msg, size_t len, const uint8_t mac[SM3_DIGEST_SIZE]) {
+    uint8_t computed[SM3_DIGEST_SIZE];
+    sm3_hmac(key, msg, len, computed);
+    return sm3_hmac_equal(computed, mac) ? 0 : -1;
+}
+
+// ---------- 批量接口 ----------
+// 每次最多处理 SM3_HMAC_CHUNK 条，内层摘要放在栈上
+#define SM3_HMAC_CHUNK 256
+
+void sm3_hmac_batch(const sm3_hmac_key *key, const uint8_t *const msgs[], const size_t lens[],
+                    uint8_t (*macs)[SM3_DIGEST_SIZE], size_t n) {
+    uint8_t inner[SM3_HMAC_CHUNK][SM3_DIGEST_SIZE];
+    for (size_t i = 0; i < n; i += SM3_HMAC_CHUNK) {
+        size_t cnt = n - i < SM3_HMAC_CHUNK ? n - i : SM3_HMAC_CHUNK;
+        sm3_hash_many_from_state(key->inner, SM3_BLOCK_SIZE, msgs + i, lens + i, inner, cnt);
+        sm3_hash_fixed_from_state(key->outer, SM3_BLOCK_SIZE, inner[0], SM3_DIGEST_SIZE, macs + i, cnt);
+    }
+}
+
+size_t sm3_hmac_verify_batch(const sm3_hmac_key *key, const uint8_t *const msgs[], const size_t lens[],
+                             const uint8_t (*macs)[SM3_DIGEST_SIZE], int *results, size_t n) {
+    uint8_t computed[SM3_HMAC_CHUNK][SM3_DIGEST_SIZE];
+    size_t passed = 0;
+    for (size_t i = 0; i < n; i += SM3_HMAC_CHUNK) {
+        size_t cnt = n - i < SM3_HMAC_CHUNK ? n - i : SM3_HMAC_CHUNK;
+        sm3_hmac_batch(key, msgs + i, lens + i, computed, cnt);
+        for (size_t j = 0; j < cnt; j++) {
+            int ok = sm3_hmac_equal(computed[j], macs[i + j]);
+            passed += ok;
+            if (results != NULL) {
+                results[i + j] = ok ? 0 : -1;
+            }
+        }
+    }
+    return passed;
+}
+
+
+#ifndef SM3_HMAC_NO_MAIN
+static void print_mac(const uint8_t mac[32]) {
+    for (int i = 0; i < 32; i++) {
+        printf("%02x", mac[i]);
+    }
+}
+
+// RFC 4231 的输入（密钥短于、等于、长于一个分组），期望值由 openssl dgst -sm3 -mac HMAC 得到
+static int sm3_hmac_kat(void) {
+    static uint8_t key_0b[20], key_aa64[64], key_aa131[131];
+    memset(key_0b, 0x0B, sizeof(key_0b));
+    memset(key_aa64, 0xAA, sizeof(key_aa64));
+    memset(key_aa131, 0xAA, sizeof(key_aa131));
+    static const char *large_key_msg = "Test Using Larger Than Block-Size Key - Hash Key First";
+    const struct {
+        const uint8_t *key;
+        size_t klen;
+        const char *msg;
+        uint8_t expect[32];
+    } tests[] = {
+        {key_0b, sizeof(key_0b), "Hi There",
+         {0x51, 0xB0, 0x0D, 0x1F, 0xB4, 0x98, 0x32, 0xBF, 0xB0, 0x1C, 0x3C, 0xE2, 0x78, 0x48, 0xE5, 0x9F,
+          0x87, 0x1D, 0x9B, 0xA9, 0x38, 0xDC, 0x56, 0x3B, 0x33, 0x8C, 0xA9, 0x64, 0x75, 0x5C, 0xCE, 0x70}},
+        {(const uint8_t *)"Jefe", 4, "what do ya want for nothing?",
+         {0x2E, 0x87, 0xF1, 0xD1, 0x68, 0x62, 0xE6, 0xD9, 0x64, 0xB5, 0x0A, 0x52, 0x00, 0xBF, 0x2B, 0x10,
+          0xB7, 0x64, 0xFA, 0xA9, 0x68, 0x0A, 0x29, 0x6A, 0x24, 0x05, 0xF2, 0x4B, 0xEC, 0x39, 0xF8, 0x82}},
+        {key_aa64, sizeof(key_aa64), large_key_msg,
+         {0x54, 0x3F, 0x72, 0x8A, 0x31, 0xBC, 0x20, 0x73, 0xD8, 0x9F, 0xDC, 0x61, 0xA4, 0xD6, 0xC4, 0x7E,
+          0x2B, 0x74, 0x11, 0x69, 0x10, 0x4B, 0xFD, 0x44, 0x57, 0xB2, 0x4F, 0x37, 0xC2, 0xF5, 0x68, 0xA2}},
+        {key_aa131, sizeof(key_aa131), large_key_msg,
+         {0xB4, 0xFD, 0x84, 0x4E, 0x13, 0x34, 0x20, 0x02, 0xF0, 0xB2, 0xE0, 0x69, 0x0E, 0xA7, 0x74, 0x1F,
+          0x14, 0x97, 0xD9, 0x93, 0xA7, 0x04, 0x94, 0xCE, 0xA6, 0x01, 0xE6, 0x57, 0xBE, 0xDF, 0x67, 0xA0}},
+    };
+
+    int all = 1;
+    for (size_t t = 0; t < sizeof(tests) / sizeof(tests[0]); t++) {
+        sm3_hmac_key key;
+        uint8_t mac[32];
+        sm3_hmac_set_key(&key, tests[t].key, tests[t].klen);
+        sm3_hmac(&key, (const uint8_t *)tests[t].msg, strlen(tests[t].msg), mac);
+        int ok = memcmp(mac, tests[t].expect, 32) == 0 &&
+                 sm3_hmac_verify(&key, (const uint8_t *)tests[t].msg, strlen(tests[t].msg), tests[t].expect) == 0;
+        printf("key %3zu 字节: ", tests[t].klen);
+        print_mac(mac);
+        printf("  %s\n", ok ? "OK" : "FAIL");
+        all &= ok;
+    }
+    return all;
+}
+
+// 批量接口与逐条接口比较，篡改一个字节后必须验证失败
+static int sm3_hmac_batch_check(const sm3_hmac_key *key) {
+    enum { N = 1000 };
+    static uint8_t data[N * 200];
+    static const uint8_t *msgs[N];
+    static size_t lens[N];
+    static uint8_t macs[N][32];
+    static int results[N];
+
+    srand(20);
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = rand() & 0xFF;
+    }
+    for (size_t i = 0; i < N; i++) {
+        msgs[i] = data + i * 200;
+        lens[i] = (size_t)(rand() % 201);
+    }
+
+    int ok = 1;
+    sm3_mb_impl saved = sm3_mb_get_impl();
+    for (int impl = 0; impl < SM3_MB_COUNT; impl++) {
+        if (sm3_mb_set_impl((sm3_mb_impl)impl) != 0) {
+            continue;
+        }
+        sm3_hmac_batch(key, msgs, lens, macs, N);
+        for (size_t i = 0; i < N; i++) {
+            uint8_t expect[32];
+            sm3_hmac(key, msgs[i], lens[i], expect);
+            ok &= memcmp(macs[i], expect, 32) == 0;
+        }
+        ok &= sm3_hmac_verify_batch(key, msgs, lens, (const uint8_t (*)[32])macs, results, N) == N;
+        macs[N / 2][7] ^= 1;
+        ok &= sm3_hmac_verify_batch(key, msgs, lens, (const uint8_t (*)[32])macs, results, N) == N - 1;
+        ok &= results[N / 2] == -1 && results[N / 2 - 1] == 0;
+        macs[N / 2][7] ^= 1;
+    }
+    sm3_mb_set_impl(saved);
+    return ok;
+}
+
+// 短消息的 MAC 开销：每次重新压缩密钥分组 / 缓存中间状态 / 批量
+static void sm3_hmac_bench(const sm3_hmac_key *key, size_t msg_len) {
+    enum { N = 1 << 16 };
+    static uint8_t data[N * 64];
+    static const uint8_t *msgs[N];
+    static size_t lens[N];
+    static uint8_t macs[N][32];
+    const uint8_t raw_key[32] = {1, 2, 3};
+    for (size_t i = 0; i < N; i++) {
+        msgs[i] = data + i * 64;
+        lens[i] = msg_len;
+    }
+
+    clock_t t0 = clock();
+    for (size_t i = 0; i < N; i++) {
+        sm3_hmac_key k;
+        sm3_hmac_set_key(&k, raw_key, sizeof(raw_key));
+        sm3_hmac(&k, msgs[i], lens[i], macs[i]);
+    }
+    double naive = (double)(clock() - t0) / CLOCKS_PER_SEC * 1e9 / N;
+
+    t0 = clock();
+    for (size_t i = 0; i < N; i++) {
+        sm3_hmac(key, msgs[i], lens[i], macs[i]);
+    }
+    double cached = (double)(clock() - t0) / CLOCKS_PER_SEC * 1e9 / N;
+
+    t0 = clock();
+    sm3_hmac_batch(key, msgs, lens, macs, N);
+    double batch = (double)(clock() - t0) / CLOCKS_PER_SEC * 1e9 / N;
+
+    printf("  %3zu 字节: 每次设置密钥 %6.0f ns   缓存中间状态 %6.0f ns   批量(%s) %6.0f ns\n", msg_len, naive, cached,
+           sm3_mb_impl_name(sm3_mb_get_impl()), batch);
+}
+
+int main(void) {
+    printf("HMAC-SM3\n");
+    int ok = sm3_hmac_kat();
+
+    // 流式输入与一次性结果一致
+    sm3_hmac_key key;
+    sm3_hmac_set_key(&key, (const uint8_t *)"gateway-key", 11);
+    uint8_t msg[300], a[32], b[32];
+    for (int i = 0; i < 300; i++) {
+        msg[i] = (uint8_t)(i * 7);
+    }
+    sm3_hmac(&key, msg, sizeof(msg), a);
+    sm3_hmac_ctx ctx;
+    sm3_hmac_init(&ctx, &key);
+    for (size_t off = 0; off < sizeof(msg); off += 37) {
+        sm3_hmac_update(&ctx, msg + off, sizeof(msg) - off < 37 ? sizeof(msg) - off : 37);
+    }
+    sm3_hmac_final(&ctx, b);
+    int stream_ok = memcmp(a, b, 32) == 0;
+    printf("streaming vs one-shot: %s\n", stream_ok ? "OK" : "FAIL");
+
+    int batch_ok = sm3_hmac_batch_check(&key);
+    printf("batch / verify_batch (all backends): %s\n", batch_ok ? "OK" : "FAIL");
+
+    printf("\n单条 MAC 耗时\n");
+    sm3_hmac_bench(&key, 16);
+    sm3_hmac_bench(&key, 64);
+    sm3_hmac_clear_key(&key);
+    return ok && stream_ok && batch_ok ? 0 : 1;
+}
+#endif
@@ -0,0 +1,46 @@
+#ifndef SM3_HMAC_H
+#define SM3_HMAC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sm3.h"
+
+// HMAC-SM3（GB/T 15852.2，与 RFC 2104 结构相同）：
+// MAC = H((K ⊕ opad) || H((K ⊕ ipad) || m))
+// 两个密钥分组只与密钥有关，设置密钥时各压缩一次并缓存链接变量（中间状态）；
+// 之后每个 MAC 只压缩消息分组，再加外层的一个分组
+typedef struct {
+    uint32_t inner[8];          // 压缩 K ⊕ ipad 之后的状态
+    uint32_t outer[8];          // 压缩 K ⊕ opad 之后的状态
+} sm3_hmac_key;
+
+// 密钥长度任意，超过 64 字节时先做一次 SM3
+void sm3_hmac_set_key(sm3_hmac_key *key, const uint8_t *k, size_t klen);
+// 用完后擦除缓存的中间状态
+void sm3_hmac_clear_key(sm3_hmac_key *key);
+
+// 流式接口：key 在 final 之前必须保持有效
+typedef struct {
+    sm3_ctx inner;
+    const sm3_hmac_key *key;
+} sm3_hmac_ctx;
+
+void sm3_hmac_init(sm3_hmac_ctx *ctx, const sm3_hmac_key *key);
+void sm3_hmac_update(sm3_hmac_ctx *ctx, const uint8_t *data, size_t len);
+void sm3_hmac_final(sm3_hmac_ctx *ctx, uint8_t mac[SM3_DIGEST_SIZE]);
+
+// 一次性接口
+void sm3_hmac(const sm3_hmac_key *key, const uint8_t *msg, size_t len, uint8_t mac[SM3_DIGEST_SIZE]);
+// 常数时间比较，通过返回 0，否则返回 -1
+int sm3_hmac_verify(const sm3_hmac_key *key, const uint8_t *msg, size_t len, const uint8_t mac[SM3_DIGEST_SIZE]);
+
+// 批量接口（同一密钥）：内层用 sm3_hash_many_from_state 多缓冲区计算，外层是定长 32 字节，
+// 用 sm3_hash_fixed_from_state 计算
+void sm3_hmac_batch(const sm3_hmac_key *key, const uint8_t *const msgs[], const size_t lens[],
+                    uint8_t (*macs)[SM3_DIGEST_SIZE], size_t n);
+// results[i] = 0 表示第 i 条通过，-1 表示失败（results 可以为 NULL）；返回通过的条数
+size_t sm3_hmac_verify_batch(const sm3_hmac_key *key, const uint8_t *const msgs[], const size_t lens[],
+                             const uint8_t (*macs)[SM3_DIGEST_SIZE], int *results, size_t n);
+
+#endif
@@ -0,0 +1,745 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define SM3_X86
+#include <immintrin.h>
+#include <x86intrin.h>
+#endif
+
+#include "sm3_mb.h"
+
+// 转置状态：st[i][l] 为第 l 个通道的第 i 个状态字
+typedef uint32_t sm3_mb_state[8][SM3_MB_MAX_LANES];
+
+// 所有通道各压缩 nblocks 个分组，p[l] 为第 l 个通道的数据（连续的 nblocks*64 字节）。
+// iv 非空时忽略 st 的输入，所有通道从同一个链接变量 iv 开始（直接在寄存器中广播，定长批量接口使用）
+typedef void (*sm3_mb_blocks_fn)(sm3_mb_state st, const uint8_t *const p[], size_t nblocks, const uint32_t *iv);
+
+static const uint32_t sm3_mb_iv[8] = {
+    0x7380166F, 0x4914B2B9, 0x172442D7, 0xDA8A0600,
+    0xA96F30BC, 0x163138AA, 0xE38DEE4D, 0xB0FB0E4E
+};
+
+#ifdef SM3_X86
+// ---------- 通用的向量轮函数，V 为后端前缀（V8：AVX2，V16：AVX-512） ----------
+#define SM3_MB_P0(V, x) V##_XOR3(x, V##_ROL(x, 9), V##_ROL(x, 17))
+#define SM3_MB_P1(V, x) V##_XOR3(x, V##_ROL(x, 15), V##_ROL(x, 23))
+
+// 与 sm3_compress_unrolled 相同：轮换参数位置代替寄存器搬移，W 为 16 字滑动窗口
+#define SM3_MB_ROUND(V, A, B, C, D, E, F, G, H, j, FF, GG) do {                 \
+        V##_T A12 = V##_ROL(A, 12);                                             \
+        V##_T SS1 = V##_ROL(V##_ADD(V##_ADD(A12, E), V##_SET1(sm3_T_rotl[j])), 7); \
+        V##_T SS2 = V##_XOR(SS1, A12);                                          \
+        V##_T Wj = w[(j) & 15];                                                 \
+        V##_T W1j = V##_XOR(Wj, w[((j) + 4) & 15]);                             \
+        D = V##_ADD(V##_ADD(V##_##FF(A, B, C), D), V##_ADD(SS2, W1j));          \
+        H = V##_ADD(V##_ADD(V##_##GG(E, F, G), H), V##_ADD(SS1, Wj));           \
+        B = V##_ROL(B, 9);                                                      \
+        F = V##_ROL(F, 19);                                                     \
+        H = SM3_MB_P0(V, H);                                                    \
+    } while (0)
+
+#define SM3_MB_EXPAND(V, i)                                                     \
+    (w[(i) & 15] = V##_XOR3(SM3_MB_P1(V, V##_XOR3(w[(i) & 15], w[((i) - 9) & 15], \
+                                                  V##_ROL(w[((i) - 3) & 15], 15))), \
+                            V##_ROL(w[((i) - 13) & 15], 7), w[((i) - 6) & 15]))
+#define SM3_MB_NO_EXPAND(V, i) ((void)0)
+
+#define SM3_MB_ROUND4(V, j, FF, GG, EXP) do {                                   \
+        EXP(V, (j) + 4); SM3_MB_ROUND(V, A, B, C, D, E, F, G, H, (j), FF, GG);     \
+        EXP(V, (j) + 5); SM3_MB_ROUND(V, D, A, B, C, H, E, F, G, (j) + 1, FF, GG); \
+        EXP(V, (j) + 6); SM3_MB_ROUND(V, C, D, A, B, G, H, E, F, (j) + 2, FF, GG); \
+        EXP(V, (j) + 7); SM3_MB_ROUND(V, B, C, D, A, F, G, H, E, (j) + 3, FF, GG); \
+    } while (0)
+
+#define SM3_MB_ROUNDS(V) do {                                                   \
+        SM3_MB_ROUND4(V, 0, FF0, GG0, SM3_MB_NO_EXPAND);                        \
+        SM3_MB_ROUND4(V, 4, FF0, GG0, SM3_MB_NO_EXPAND);                        \
+        SM3_MB_ROUND4(V, 8, FF0, GG0, SM3_MB_NO_EXPAND);                        \
+        SM3_MB_ROUND4(V, 12, FF0, GG0, SM3_MB_EXPAND);                          \
+        SM3_MB_ROUND4(V, 16, FF1, GG1, SM3_MB_EXPAND);                          \
+        SM3_MB_ROUND4(V, 20, FF1, GG1, SM3_MB_EXPAND);                          \
+        SM3_MB_ROUND4(V, 24, FF1, GG1, SM3_MB_EXPAND);                          \
+        SM3_MB_ROUND4(V, 28, FF1, GG1, SM3_MB_EXPAND);                          \
+        SM3_MB_ROUND4(V, 32, FF1, GG1, SM3_MB_EXPAND);                          \
+        SM3_MB_ROUND4(V, 36, FF1, GG1, SM3_MB_EXPAND);                          \
+        SM3_MB_ROUND4(V, 40, FF1, GG1, SM3_MB_EXPAND);                          \
+        SM3_MB_ROUND4(V, 44, FF1, GG1, SM3_MB_EXPAND);                          \
+        SM3_MB_ROUND4(V, 48, FF1, GG1, SM3_MB_EXPAND);                          \
+        SM3_MB_ROUND4(V, 52, FF1, GG1, SM3_MB_EXPAND);                          \
+        SM3_MB_ROUND4(V, 56, FF1, GG1, SM3_MB_EXPAND);                          \
+        SM3_MB_ROUND4(V, 60, FF1, GG1, SM3_MB_EXPAND);                          \
+    } while (0)
+
+// 每个 128 位通道内的 32 位字节序翻转
+static const uint8_t sm3_mb_bswap32[16] = {3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12};
+
+// ---------- AVX2：8 个通道 ----------
+#define SM3_MB_TARGET_AVX2 __attribute__((target("avx2")))
+
+#define V8_T __m256i
+#define V8_ADD(a, b) _mm256_add_epi32(a, b)
+#define V8_XOR(a, b) _mm256_xor_si256(a, b)
+#define V8_XOR3(a, b, c) V8_XOR(V8_XOR(a, b), c)
+#define V8_ROL(x, n) _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - (n)))
+#define V8_SET1(c) _mm256_set1_epi32((int)(c))
+#define V8_FF0(x, y, z) V8_XOR3(x, y, z)
+#define V8_GG0(x, y, z) V8_XOR3(x, y, z)
+#define V8_FF1(x, y, z) _mm256_or_si256(_mm256_and_si256(x, y), _mm256_and_si256(_mm256_or_si256(x, y), z))
+#define V8_GG1(x, y, z) _mm256_or_si256(_mm256_and_si256(x, y), _mm256_andnot_si256(x, z))
+
+// 8 个通道各取 32 字节（8 个字），转置后 w[i] 为各通道的第 i 个字
+SM3_MB_TARGET_AVX2
+static inline void sm3_mb_avx2_load8(const uint8_t *const p[], size_t off, __m256i w[8]) {
+    __m256i bswap = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)sm3_mb_bswap32));
+    __m256i r[8], t[8];
+    for (int l = 0; l < 8; l++) {
+        r[l] = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *)(p[l] + off)), bswap);
+    }
+    for (int l = 0; l < 8; l += 2) {
+        t[l] = _mm256_unpacklo_epi32(r[l], r[l + 1]);
+        t[l + 1] = _mm256_unpackhi_epi32(r[l], r[l + 1]);
+    }
+    // r[4g+c] 的 128 位半边 h 为通道 4g..4g+3 的第 4h+c 个字
+    for (int g = 0; g < 8; g += 4) {
+        r[g] = _mm256_unpacklo_epi64(t[g], t[g + 2]);
+        r[g + 1] = _mm256_unpackhi_epi64(t[g], t[g + 2]);
+        r[g + 2] = _mm256_unpacklo_epi64(t[g + 1], t[g + 3]);
+        r[g + 3] = _mm256_unpackhi_epi64(t[g + 1], t[g + 3]);
+    }
+    for (int c = 0; c < 4; c++) {
+        w[c] = _mm256_permute2x128_si256(r[c], r[c + 4], 0x20);
+        w[c + 4] = _mm256_permute2x128_si256(r[c], r[c + 4], 0x31);
+    }
+}
+
+SM3_MB_TARGET_AVX2
+static void sm3_mb_avx2_blocks(sm3_mb_state st, const uint8_t *const p[], size_t nblocks, const uint32_t *iv) {
+    __m256i A, B, C, D, E, F, G, H;
+    if (iv != NULL) {
+        A = _mm256_set1_epi32((int)iv[0]);
+        B = _mm256_set1_epi32((int)iv[1]);
+        C = _mm256_set1_epi32((int)iv[2]);
+        D = _mm256_set1_epi32((int)iv[3]);
+        E = _mm256_set1_epi32((int)iv[4]);
+        F = _mm256_set1_epi32((int)iv[5]);
+        G = _mm256_set1_epi32((int)iv[6]);
+        H = _mm256_set1_epi32((int)iv[7]);
+    } else {
+        A = _mm256_loadu_si256((const __m256i *)st[0]);
+        B = _mm256_loadu_si256((const __m256i *)st[1]);
+        C = _mm256_loadu_si256((const __m256i *)st[2]);
+        D = _mm256_loadu_si256((const __m256i *)st[3]);
+        E = _mm256_loadu_si256((const __m256i *)st[4]);
+        F = _mm256_loadu_si256((const __m256i *)st[5]);
+        G = _mm256_loadu_si256((const __m256i *)st[6]);
+        H = _mm256_loadu_si256((const __m256i *)st[7]);
+    }
+
+    for (size_t n = 0; n < nblocks; n++) {
+        __m256i w[16];
+        sm3_mb_avx2_load8(p, n * SM3_BLOCK_SIZE, w);
+        sm3_mb_avx2_load8(p, n * SM3_BLOCK_SIZE + 32, w + 8);
+
+        __m256i A0 = A, B0 = B, C0 = C, D0 = D, E0 = E, F0 = F, G0 = G, H0 = H;
+        SM3_MB_ROUNDS(V8);
+        A = V8_XOR(A, A0); B = V8_XOR(B, B0); C = V8_XOR(C, C0); D = V8_XOR(D, D0);
+        E = V8_XOR(E, E0); F = V8_XOR(F, F0); G = V8_XOR(G, G0); H = V8_XOR(H, H0);
+    }
+
+    _mm256_storeu_si256((__m256i *)st[0], A);
+    _mm256_storeu_si256((__m256i *)st[1], B);
+    _mm256_storeu_si256((__m256i *)st[2], C);
+    _mm256_storeu_si256((__m256i *)st[3], D);
+    _mm256_storeu_si256((__m256i *)st[4], E);
+    _mm256_storeu_si256((__m256i *)st[5], F);
+    _mm256_storeu_si256((__m256i *)st[6], G);
+    _mm256_storeu_si256((__m256i *)st[7], H);
+}
+
+static int sm3_mb_avx2_supported(void) {
+    return __builtin_cpu_supports("avx2");
+}
+
+// ---------- AVX-512：16 个通道，VPROLD 完成循环移位，VPTERNLOGD 完成三输入布尔函数 ----------
+#define SM3_MB_TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+
+#define V16_T __m512i
+#define V16_ADD(a, b) _mm512_add_epi32(a, b)
+#define V16_XOR(a, b) _mm512_xor_si512(a, b)
+#define V16_XOR3(a, b, c) _mm512_ternarylogic_epi32(a, b, c, 0x96)
+#define V16_ROL(x, n) _mm512_rol_epi32(x, n)
+#define V16_SET1(c) _mm512_set1_epi32((int)(c))
+#define V16_FF0(x, y, z) V16_XOR3(x, y, z)
+#define V16_GG0(x, y, z) V16_XOR3(x, y, z)
+// 多数函数与选择函数的真值表
+#define V16_FF1(x, y, z) _mm512_ternarylogic_epi32(x, y, z, 0xE8)
+#define V16_GG1(x, y, z) _mm512_ternarylogic_epi32(x, y, z, 0xCA)
+
+// 16 个通道各取一个完整分组，16x16 转置后 w[i] 为各通道的第 i 个字
+SM3_MB_TARGET_AVX512
+static inline void sm3_mb_avx512_load16(const uint8_t *const p[], size_t off, __m512i w[16]) {
+    __m512i bswap = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)sm3_mb_bswap32));
+    __m512i r[16], t[16];
+    for (int l = 0; l < 16; l++) {
+        r[l] = _mm512_shuffle_epi8(_mm512_loadu_si512(p[l] + off), bswap);
+    }
+    for (int l = 0; l < 16; l += 2) {
+        t[l] = _mm512_unpacklo_epi32(r[l], r[l + 1]);
+        t[l + 1] = _mm512_unpackhi_epi32(r[l], r[l + 1]);
+    }
+    // r[4g+c] 的 128 位通道 k 为通道 4g..4g+3 的第 4k+c 个字
+    for (int g = 0; g < 16; g += 4) {
+        r[g] = _mm512_unpacklo_epi64(t[g], t[g + 2]);
+        r[g + 1] = _mm512_unpackhi_epi64(t[g], t[g + 2]);
+        r[g + 2] = _mm512_unpacklo_epi64(t[g + 1], t[g + 3]);
+        r[g + 3] = _mm512_unpackhi_epi64(t[g + 1], t[g + 3]);
+    }
+    // 128 位通道间的 4x4 转置
+    for (int c = 0; c < 4; c++) {
+        __m512i x0 = _mm512_shuffle_i32x4(r[c], r[c + 4], 0x88);
+        __m512i x1 = _mm512_shuffle_i32x4(r[c], r[c + 4], 0xDD);
+        __m512i y0 = _mm512_shuffle_i32x4(r[c + 8], r[c + 12], 0x88);
+        __m512i y1 = _mm512_shuffle_i32x4(r[c + 8], r[c + 12], 0xDD);
+        w[c] = _mm512_shuffle_i32x4(x0, y0, 0x88);
+        w[c + 4] = _mm512_shuffle_i32x4(x1, y1, 0x88);
+        w[c + 8] = _mm512_shuffle_i32x4(x0, y0, 0xDD);
+        w[c + 12] = _mm512_shuffle_i32x4(x1, y1, 0xDD);
+    }
+}
+
+SM3_MB_TARGET_AVX512
+static void sm3_mb_avx512_blocks(sm3_mb_state st, const uint8_t *const p[], size_t nblocks, const uint32_t *iv) {
+    __m512i A, B, C, D, E, F, G, H;
+    if (iv != NULL) {
+        A = _mm512_set1_epi32((int)iv[0]);
+        B = _mm512_set1_epi32((int)iv[1]);
+        C = _mm512_set1_epi32((int)iv[2]);
+        D = _mm512_set1_epi32((int)iv[3]);
+        E = _mm512_set1_epi32((int)iv[4]);
+        F = _mm512_set1_epi32((int)iv[5]);
+        G = _mm512_set1_epi32((int)iv[6]);
+        H = _mm512_set1_epi32((int)iv[7]);
+    } else {
+        A = _mm512_loadu_si512(st[0]);
+        B = _mm512_loadu_si512(st[1]);
+        C = _mm512_loadu_si512(st[2]);
+        D = _mm512_loadu_si512(st[3]);
+        E = _mm512_loadu_si512(st[4]);
+        F = _mm512_loadu_si512(st[5]);
+        G = _mm512_loadu_si512(st[6]);
+        H = _mm512_loadu_si512(st[7]);
+    }
+
+    for (size_t n = 0; n < nblocks; n++) {
+        __m512i w[16];
+        sm3_mb_avx512_load16(p, n * SM3_BLOCK_SIZE, w);
+
+        __m512i A0 = A, B0 = B, C0 = C, D0 = D, E0 = E, F0 = F, G0 = G, H0 = H;
+        SM3_MB_ROUNDS(V16);
+        A = V16_XOR(A, A0); B = V16_XOR(B, B0); C = V16_XOR(C, C0); D = V16_XOR(D, D0);
+        E = V16_XOR(E, E0); F = V16_XOR(F, F0); G = V16_XOR(G, G0); H = V16_XOR(H, H0);
+    }
+
+    _mm512_storeu_si512(st[0], A);
+    _mm512_storeu_si512(st[1], B);
+    _mm512_storeu_si512(st[2], C);
+    _mm512_storeu_si512(st[3], D);
+    _mm512_storeu_si512(st[4], E);
+    _mm512_storeu_si512(st[5], F);
+    _mm512_storeu_si512(st[6], G);
+    _mm512_storeu_si512(st[7], H);
+}
+
+static int sm3_mb_avx512_supported(void) {
+    return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+}
+#endif
+
+// ---------- 后端表与选择 ----------
+static int sm3_mb_scalar_supported(void) {
+    return 1;
+}
+
+typedef struct {
+    const char *name;
+    int (*supported)(void);
+    size_t lanes;
+    sm3_mb_blocks_fn blocks;    // 标量实现为 NULL
+} sm3_mb_backend;
+
+static const sm3_mb_backend sm3_mb_backends[SM3_MB_COUNT] = {
+    {"scalar", sm3_mb_scalar_supported, 1, NULL},
+#ifdef SM3_X86
+    {"avx2", sm3_mb_avx2_supported, 8, sm3_mb_avx2_blocks},
+    {"avx512", sm3_mb_avx512_supported, 16, sm3_mb_avx512_blocks},
+#else
+    {"avx2", NULL, 8, NULL},
+    {"avx512", NULL, 16, NULL},
+#endif
+};
+
+// 自动选择时的优先级，从快到慢
+static const sm3_mb_impl sm3_mb_impl_preference[] = {SM3_MB_AVX512, SM3_MB_AVX2, SM3_MB_SCALAR};
+
+static sm3_mb_impl sm3_mb_active_impl = SM3_MB_COUNT;
+
+int sm3_mb_impl_available(sm3_mb_impl impl) {
+    if (impl < 0 || impl >= SM3_MB_COUNT || sm3_mb_backends[impl].supported == NULL) {
+        return 0;
+    }
+    return sm3_mb_backends[impl].supported();
+}
+
+const char *sm3_mb_impl_name(sm3_mb_impl impl) {
+    if (impl < 0 || impl >= SM3_MB_COUNT) {
+        return "unknown";
+    }
+    return sm3_mb_backends[impl].name;
+}
+
+size_t sm3_mb_impl_lanes(sm3_mb_impl impl) {
+    if (impl < 0 || impl >= SM3_MB_COUNT) {
+        return 0;
+    }
+    return sm3_mb_backends[impl].lanes;
+}
+
+int sm3_mb_set_impl(sm3_mb_impl impl) {
+    if (!sm3_mb_impl_available(impl)) {
+        return -1;
+    }
+    sm3_mb_active_impl = impl;
+    return 0;
+}
+
+// 启动时按 CPUID 选择默认后端（与 project1/SM4.c 的 sm4_select_impl 相同）
+__attribute__((constructor)) static void sm3_mb_select_impl(void) {
+#ifdef SM3_X86
+    __builtin_cpu_init();
+#endif
+    if (sm3_mb_active_impl != SM3_MB_COUNT) {
+        return;
+    }
+    size_t n = sizeof(sm3_mb_impl_preference) / sizeof(sm3_mb_impl_preference[0]);
+    for (size_t i = 0; i < n; ++i) {
+        if (sm3_mb_impl_available(sm3_mb_impl_preference[i])) {
+            sm3_mb_active_impl = sm3_mb_impl_preference[i];
+            break;
+        }
+    }
+}
+
+sm3_mb_impl sm3_mb_get_impl(void) {
+    if (sm3_mb_active_impl == SM3_MB_COUNT) {
+        sm3_mb_select_impl();
+    }
+    return sm3_mb_active_impl;
+}
+
+// ---------- 通道调度 ----------
+// 每个通道依次经过两段数据：消息本身的整分组（直接读调用者的缓冲区），
+// 然后是通道内构造的 1~2 个填充分组
+typedef struct {
+    size_t job;                         // 正在处理的消息下标
+    const uint8_t *ptr;                 // 下一个待压缩的分组
+    size_t left;                        // 当前这段数据剩余的分组数
+    int in_tail;                        // 是否已进入填充分组
+    size_t tail_blocks;
+    uint8_t tail[2 * SM3_BLOCK_SIZE];
+} sm3_mb_lane;
+
+// iv 为已压缩 processed_len 字节之后的链接变量，填充中的长度按 processed_len + len 计算
+static void sm3_mb_lane_start(sm3_mb_state st, size_t l, sm3_mb_lane *lane, size_t job,
+                              const uint32_t iv[8], uint64_t processed_len, const uint8_t *msg, size_t len) {
+    for (int i = 0; i < 8; i++) {
+        st[i][l] = iv[i];
+    }
+
+    // 与 sm3_final 相同的填充：0x80 || 0...0 || [比特长度]_64
+    size_t full = len / SM3_BLOCK_SIZE;
+    size_t rem = len % SM3_BLOCK_SIZE;
+    memset(lane->tail, 0, sizeof(lane->tail));
+    memcpy(lane->tail, msg + full * SM3_BLOCK_SIZE, rem);
+    lane->tail[rem] = 0x80;
+    lane->tail_blocks = rem + 1 + 8 > SM3_BLOCK_SIZE ? 2 : 1;
+    uint64_t bit_len = (processed_len + len) * 8;
+    for (int i = 0; i < 8; i++) {
+        lane->tail[lane->tail_blocks * SM3_BLOCK_SIZE - 8 + i] = (bit_len >> (56 - i * 8)) & 0xFF;
+    }
+
+    lane->job = job;
+    if (full > 0) {
+        lane->ptr = msg;
+        lane->left = full;
+        lane->in_tail = 0;
+    } else {
+        lane->ptr = lane->tail;
+        lane->left = lane->tail_blocks;
+        lane->in_tail = 1;
+    }
+}
+
+static void sm3_mb_store_digest(const uint32_t state[8], uint8_t digest[SM3_DIGEST_SIZE]) {
+    for (int i = 0; i < 8; i++) {
+        uint32_t v = __builtin_bswap32(state[i]);   // 大端序输出
+        memcpy(digest + i * 4, &v, 4);
+    }
+}
+
+// 只剩一条消息时向量化没有收益，取出该通道的状态用标量压缩函数完成
+static void sm3_mb_lane_finish_scalar(sm3_mb_state st, size_t l, sm3_mb_lane *lane, uint8_t digest[SM3_DIGEST_SIZE]) {
+    uint32_t state[8];
+    for (int i = 0; i < 8; i++) {
+        state[i] = st[i][l];
+    }
+    sm3_compress_blocks(state, lane->ptr, lane->left);
+    if (!lane->in_tail) {
+        sm3_compress_blocks(state, lane->tail, lane->tail_blocks);
+    }
+    sm3_mb_store_digest(state, digest);
+}
+
+void sm3_hash_many_from_state(const uint32_t iv[8], uint64_t processed_len, const uint8_t *const msgs[],
+                              const size_t lens[], uint8_t (*digests)[SM3_DIGEST_SIZE], size_t n) {
+    const sm3_mb_backend *b = &sm3_mb_backends[sm3_mb_get_impl()];
+    if (b->blocks == NULL) {
+        for (size_t i = 0; i < n; i++) {
+            sm3_ctx ctx;
+            sm3_init_from_state(&ctx, iv, processed_len);
+            sm3_update(&ctx, msgs[i], lens[i]);
+            sm3_final(&ctx, digests[i]);
+        }
+        return;
+    }
+
+    size_t lanes = b->lanes;
+    sm3_mb_state st;
+    sm3_mb_lane lane[SM3_MB_MAX_LANES];
+    int busy[SM3_MB_MAX_LANES];
+    size_t next = 0, active = 0;
+
+    memset(st, 0, sizeof(st));
+    for (size_t l = 0; l < lanes; l++) {
+        busy[l] = next < n;
+        if (busy[l]) {
+            sm3_mb_lane_start(st, l, &lane[l], next, iv, processed_len, msgs[next], lens[next]);
+            next++;
+            active++;
+        }
+    }
+
+    while (active > 0) {
+        // 所有忙通道共同前进 k = 最短剩余段 个分组，期间不需要调度
+        size_t k = SIZE_MAX, first = 0;
+        for (size_t l = lanes; l-- > 0;) {
+            if (busy[l]) {
+                first = l;
+                if (lane[l].left < k) {
+                    k = lane[l].left;
+                }
+            }
+        }
+
+        if (active == 1 && next == n) {
+            sm3_mb_lane_finish_scalar(st, first, &lane[first], digests[lane[first].job]);
+            break;
+        }
+
+        // 空闲通道借用第一个忙通道的数据（其长度至少为 k 个分组），结果丢弃
+        const uint8_t *p[SM3_MB_MAX_LANES];
+        for (size_t l = 0; l < lanes; l++) {
+            p[l] = busy[l] ? lane[l].ptr : lane[first].ptr;
+        }
+        b->blocks(st, p, k, NULL);
+
+        for (size_t l = 0; l < lanes; l++) {
+            if (!busy[l]) {
+                continue;
+            }
+            lane[l].ptr += k * SM3_BLOCK_SIZE;
+            lane[l].left -= k;
+            if (lane[l].left > 0) {
+                continue;
+            }
+            if (!lane[l].in_tail) {
+                lane[l].ptr = lane[l].tail;
+                lane[l].left = lane[l].tail_blocks;
+                lane[l].in_tail = 1;
+                continue;
+            }
+
+            // 该通道的消息完成，换入下一条
+            uint32_t state[8];
+            for (int i = 0; i < 8; i++) {
+                state[i] = st[i][l];
+            }
+            sm3_mb_store_digest(state, digests[lane[l].job]);
+            if (next < n) {
+                sm3_mb_lane_start(st, l, &lane[l], next, iv, processed_len, msgs[next], lens[next]);
+                next++;
+            } else {
+                busy[l] = 0;
+                active--;
+            }
+        }
+    }
+}
+
+
+void sm3_hash_many(const uint8_t *const msgs[], const size_t lens[], uint8_t (*digests)[SM3_DIGEST_SIZE], size_t n) {
+    sm3_hash_many_from_state(sm3_mb_iv, 0, msgs, lens, digests, n);
+}
+
+// ---------- 定长批量接口 ----------
+// n 条长度均为 len 的消息连续存放（第 i 条位于 in + i*len）。长度固定，所以填充分组只需构造一次，
+// 每条消息只把最后不足一个分组的数据拷进去；整分组直接从输入读取。各通道同时开始、同时结束，不需要调度
+// 总是内联到调用处，使 len 成为常量：尾部拷贝与分组数都在编译期确定
+static inline __attribute__((always_inline))
+void sm3_hash_fixed(const uint32_t iv[8], uint64_t processed_len, const uint8_t *in, size_t len,
+                    uint8_t (*out)[SM3_DIGEST_SIZE], size_t n) {
+    size_t full = len / SM3_BLOCK_SIZE;
+    size_t rem = len % SM3_BLOCK_SIZE;
+    size_t tail_blocks = rem + 1 + 8 > SM3_BLOCK_SIZE ? 2 : 1;
+    uint8_t pad[2 * SM3_BLOCK_SIZE] = {0};
+    pad[rem] = 0x80;
+    uint64_t bit_len = (processed_len + len) * 8;
+    for (int i = 0; i < 8; i++) {
+        pad[tail_blocks * SM3_BLOCK_SIZE - 8 + i] = (bit_len >> (56 - i * 8)) & 0xFF;
+    }
+
+    const sm3_mb_backend *b = &sm3_mb_backends[sm3_mb_get_impl()];
+    if (b->blocks == NULL) {
+        for (size_t i = 0; i < n; i++) {
+            const uint8_t *msg = in + i * len;
+            uint32_t state[8];
+            memcpy(state, iv, sizeof(state));
+            sm3_compress_blocks(state, msg, full);
+            memcpy(pad, msg + full * SM3_BLOCK_SIZE, rem);
+            sm3_compress_blocks(state, pad, tail_blocks);
+            sm3_mb_store_digest(state, out[i]);
+        }
+        return;
+    }
+
+    size_t lanes = b->lanes;
+    sm3_mb_state st;
+    uint8_t tail[SM3_MB_MAX_LANES][2 * SM3_BLOCK_SIZE];
+    const uint8_t *p[SM3_MB_MAX_LANES], *tail_p[SM3_MB_MAX_LANES];
+    for (size_t l = 0; l < lanes; l++) {
+        memcpy(tail[l], pad, sizeof(pad));
+        tail_p[l] = tail[l];
+    }
+
+    for (size_t i = 0; i < n; i += lanes) {
+        // 最后一组不足 lanes 条时，多余通道重复计算第 i 条，结果丢弃
+        size_t cnt = n - i < lanes ? n - i : lanes;
+        // 尾部先拷贝，到压缩填充分组时这些写入早已完成，避免向量装载等待存储转发
+        for (size_t l = 0; l < lanes; l++) {
+            p[l] = in + (i + (l < cnt ? l : 0)) * len;
+            memcpy(tail[l], p[l] + full * SM3_BLOCK_SIZE, rem);
+        }
+        if (full > 0) {
+            b->blocks(st, p, full, iv);
+        }
+        b->blocks(st, tail_p, tail_blocks, full == 0 ? iv : NULL);
+
+        for (size_t l = 0; l < cnt; l++) {
+            uint32_t state[8];
+            for (int k = 0; k < 8; k++) {
+                state[k] = st[k][l];
+            }
+            sm3_mb_store_digest(state, out[i + l]);
+        }
+    }
+}
+
+void sm3_hash_batch_65(const uint8_t (*in)[65], uint8_t (*out)[SM3_DIGEST_SIZE], size_t n) {
+    sm3_hash_fixed(sm3_mb_iv, 0, in[0], 65, out, n);
+}
+
+void sm3_hash_batch_33(const uint8_t (*in)[33], uint8_t (*out)[SM3_DIGEST_SIZE], size_t n) {
+    sm3_hash_fixed(sm3_mb_iv, 0, in[0], 33, out, n);
+}
+
+void sm3_hash_fixed_from_state(const uint32_t iv[8], uint64_t processed_len, const uint8_t *in, size_t len,
+                               uint8_t (*out)[SM3_DIGEST_SIZE], size_t n) {
+    sm3_hash_fixed(iv, processed_len, in, len, out, n);
+}
+
+#ifndef SM3_MB_NO_MAIN
+// 随机长度（含 0、恰好一个分组、跨分组边界等）的消息与 sm3_hash 比较
+static int sm3_mb_check(sm3_mb_impl impl) {
+    enum { N = 2000 };
+    static const uint8_t *msgs[N];
+    static size_t lens[N];
+    static uint8_t digests[N][32];
+    static uint8_t data[N * 300 + 20000];
+    uint8_t expect[32];
+
+    srand(17 + impl);
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = rand() & 0xFF;
+    }
+    size_t off = 0;
+    for (size_t i = 0; i < N; i++) {
+        // 大部分为短消息，少量长消息，使通道长度差异较大
+        lens[i] = (size_t)(i % 97 == 0 ? 5000 + rand() % 15000 : rand() % 300);
+        msgs[i] = data + off % (sizeof(data) - lens[i]);
+        off += 131;
+    }
+
+    sm3_mb_set_impl(impl);
+    sm3_hash_many(msgs, lens, digests, N);
+    int ok = 1;
+    for (size_t i = 0; i < N; i++) {
+        sm3_hash(msgs[i], lens[i], expect);
+        ok &= memcmp(digests[i], expect, 32) == 0;
+    }
+    // 少于通道数、只有一条
+    for (size_t n = 0; n <= 3; n++) {
+        sm3_hash_many(msgs + 1, lens + 1, digests, n);
+        for (size_t i = 0; i < n; i++) {
+            sm3_hash(msgs[1 + i], lens[1 + i], expect);
+            ok &= memcmp(digests[i], expect, 32) == 0;
+        }
+    }
+    return ok;
+}
+
+// 大量等长小消息的吞吐量（cycles/byte，rdtsc），模拟按块去重的场景
+static void sm3_mb_bench(size_t msg_len) {
+    enum { TOTAL = 1 << 22 };
+    size_t n = TOTAL / msg_len;
+    const uint8_t **msgs = malloc(n * sizeof(*msgs));
+    size_t *lens = malloc(n * sizeof(*lens));
+    uint8_t (*digests)[32] = malloc(n * sizeof(*digests));
+    uint8_t *data = malloc(TOTAL);
+    for (size_t i = 0; i < TOTAL; i++) {
+        data[i] = (uint8_t)(i * 131);
+    }
+    for (size_t i = 0; i < n; i++) {
+        msgs[i] = data + i * msg_len;
+        lens[i] = msg_len;
+    }
+
+    printf("%8zu B x %-7zu", msg_len, n);
+    for (int impl = 0; impl < SM3_MB_COUNT; impl++) {
+        if (!sm3_mb_impl_available(impl)) {
+            printf("  %8s", "-");
+            continue;
+        }
+        sm3_mb_set_impl(impl);
+        double best = 1e30;
+        for (int r = 0; r < 3; r++) {
+#ifdef SM3_X86
+            uint64_t t0 = __rdtsc();
+            sm3_hash_many(msgs, lens, digests, n);
+            double cpb = (double)(__rdtsc() - t0) / (n * msg_len);
+#else
+            clock_t t0 = clock();
+            sm3_hash_many(msgs, lens, digests, n);
+            double cpb = (double)(clock() - t0) / CLOCKS_PER_SEC * 1e9 / (n * msg_len);
+#endif
+            if (cpb < best) best = cpb;
+        }
+        printf("  %8.2f", best);
+    }
+    printf("\n");
+    free(msgs);
+    free(lens);
+    free(digests);
+    free(data);
+}
+
+// 定长批量接口与 sm3_hash 比较，并与逐条 sm3_hash 对比耗时
+static void sm3_mb_fixed_check(void) {
+    enum { N = 100000 };
+    uint8_t (*in65)[65] = malloc(N * sizeof(*in65));
+    uint8_t (*in33)[33] = malloc(N * sizeof(*in33));
+    uint8_t (*out)[32] = malloc(N * sizeof(*out));
+    uint8_t expect[32];
+    srand(19);
+    for (size_t i = 0; i < N; i++) {
+        for (int k = 0; k < 65; k++) {
+            in65[i][k] = rand() & 0xFF;
+        }
+        memcpy(in33[i], in65[i], 33);
+    }
+
+    printf("\n定长批量接口（%d 条）\n", N);
+    for (int impl = 0; impl < SM3_MB_COUNT; impl++) {
+        if (!sm3_mb_impl_available(impl)) {
+            continue;
+        }
+        sm3_mb_set_impl(impl);
+        int ok = 1;
+        for (size_t n = 0; n <= 17; n++) {    // 不足一组、恰好一组、多出几条
+            sm3_hash_batch_65(in65, out, n);
+            for (size_t i = 0; i < n; i++) {
+                sm3_hash(in65[i], 65, expect);
+                ok &= memcmp(out[i], expect, 32) == 0;
+            }
+        }
+
+        clock_t t0 = clock();
+        sm3_hash_batch_65(in65, out, N);
+        double ms65 = (double)(clock() - t0) * 1000 / CLOCKS_PER_SEC;
+        for (size_t i = 0; i < N; i += 997) {
+            sm3_hash(in65[i], 65, expect);
+            ok &= memcmp(out[i], expect, 32) == 0;
+        }
+        t0 = clock();
+        sm3_hash_batch_33(in33, out, N);
+        double ms33 = (double)(clock() - t0) * 1000 / CLOCKS_PER_SEC;
+        for (size_t i = 0; i < N; i += 997) {
+            sm3_hash(in33[i], 33, expect);
+            ok &= memcmp(out[i], expect, 32) == 0;
+        }
+        printf("  %-8s batch_65: %6.2f ms  batch_33: %6.2f ms  %s\n", sm3_mb_impl_name(impl), ms65, ms33,
+               ok ? "OK" : "FAIL");
+    }
+
+    clock_t t0 = clock();
+    for (size_t i = 0; i < N; i++) {
+        sm3_hash(in65[i], 65, out[i]);
+    }
+    printf("  逐条 sm3_hash (65 字节): %6.2f ms\n", (double)(clock() - t0) * 1000 / CLOCKS_PER_SEC);
+    free(in65);
+    free(in33);
+    free(out);
+}
+
+int main(void) {
+    printf("SM3 多缓冲区实现\n");
+    for (int impl = 0; impl < SM3_MB_COUNT; impl++) {
+        if (!sm3_mb_impl_available(impl)) {
+            printf("  %-8s (%2zu 通道): 不支持\n", sm3_mb_impl_name(impl), sm3_mb_impl_lanes(impl));
+            continue;
+        }
+        printf("  %-8s (%2zu 通道): %s\n", sm3_mb_impl_name(impl), sm3_mb_impl_lanes(impl),
+               sm3_mb_check(impl) ? "OK" : "FAIL");
+    }
+
+#ifdef SM3_X86
+    printf("\n吞吐量 (cycles/byte)\n");
+#else
+    printf("\n吞吐量 (ns/byte)\n");
+#endif
+    printf("%-18s", "消息");
+    for (int impl = 0; impl < SM3_MB_COUNT; impl++) {
+        printf("  %8s", sm3_mb_impl_name(impl));
+    }
+    printf("\n");
+    size_t sizes[] = {32, 64, 256, 1024, 4096, 65536};
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        sm3_mb_bench(sizes[i]);
+    }
+
+    sm3_mb_fixed_check();
+    return 0;
+}
+#endif
@@ -0,0 +1,44 @@
+#ifndef SM3_MB_H
+#define SM3_MB_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sm3.h"
+
+// 多缓冲区 SM3：同时计算多条相互独立的消息。状态按字转置存放（第 i 个状态字的所有通道在一个向量里），
+// 每个通道处理一条消息，消息长度可以不同；某个通道的消息结束后立即换入下一条，其余通道不受影响
+#define SM3_MB_MAX_LANES 16
+
+typedef enum {
+    SM3_MB_SCALAR,          // 逐条调用 sm3_hash，对照用
+    SM3_MB_AVX2,            // AVX2，8 个通道
+    SM3_MB_AVX512,          // AVX-512，16 个通道，VPROLD 循环移位，VPTERNLOGD 布尔函数
+    SM3_MB_COUNT
+} sm3_mb_impl;
+
+int sm3_mb_impl_available(sm3_mb_impl impl);
+const char *sm3_mb_impl_name(sm3_mb_impl impl);
+// 通道数，标量实现为 1
+size_t sm3_mb_impl_lanes(sm3_mb_impl impl);
+// 强制使用指定实现，CPU 不支持时返回 -1；默认按 CPUID 选择最宽的可用实现
+int sm3_mb_set_impl(sm3_mb_impl impl);
+sm3_mb_impl sm3_mb_get_impl(void);
+
+// 计算 n 条消息的摘要：digests[i] = SM3(msgs[i], lens[i])
+void sm3_hash_many(const uint8_t *const msgs[], const size_t lens[], uint8_t (*digests)[SM3_DIGEST_SIZE], size_t n);
+
+// 定长批量接口（Merkle 树）：65 字节 = 0x01 || 左子节点 || 右子节点，33 字节 = 0x00 || 32 字节叶子数据。
+// 填充分组预先构造，走与 sm3_hash_many 相同的多缓冲区后端，但不需要通道调度
+void sm3_hash_batch_65(const uint8_t (*in)[65], uint8_t (*out)[SM3_DIGEST_SIZE], size_t n);
+void sm3_hash_batch_33(const uint8_t (*in)[33], uint8_t (*out)[SM3_DIGEST_SIZE], size_t n);
+
+// 从中间状态继续（如 HMAC 的内外层）：每条消息之前已有 processed_len 字节（64 的倍数）压缩进 iv，
+// 与 sm3_init_from_state 的语义相同
+void sm3_hash_many_from_state(const uint32_t iv[8], uint64_t processed_len, const uint8_t *const msgs[],
+                              const size_t lens[], uint8_t (*digests)[SM3_DIGEST_SIZE], size_t n);
+// 定长版本：n 条长度均为 len 的消息连续存放在 in 中
+void sm3_hash_fixed_from_state(const uint32_t iv[8], uint64_t processed_len, const uint8_t *in, size_t len,
+                               uint8_t (*out)[SM3_DIGEST_SIZE], size_t n);
+
+#endif
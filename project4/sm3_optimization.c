@@ -3,22 +3,17 @@
 #include <string.h>
 #include <stdint.h>
 #include <time.h>
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define SM3_X86
 #include <immintrin.h>
+#include <x86intrin.h>
+#endif
+
+#include "sm3.h"
 
 // 循环左移宏
 #define ROTL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
 
-// 常量定义
-static const uint32_t T[64] = {
-    0x79CC4519, 0x79CC4519, 0x79CC4519, 0x79CC4519, 0x79CC4519, 0x79CC4519, 0x79CC4519, 0x79CC4519,
-    0x79CC4519, 0x79CC4519, 0x79CC4519, 0x79CC4519, 0x79CC4519, 0x79CC4519, 0x79CC4519, 0x79CC4519,
-    0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A,
-    0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A,
-    0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A,
-    0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A,
-    0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A, 0x7A879D8A
-};
-
 // 布尔函数
 #define FF0(x, y, z) ((x) ^ (y) ^ (z))
 #define GG0(x, y, z) ((x) ^ (y) ^ (z))
@@ -29,21 +24,18 @@ static const uint32_t T[64] = {
 #define P0(x) ((x) ^ ROTL(x, 9) ^ ROTL(x, 17))
 #define P1(x) ((x) ^ ROTL(x, 15) ^ ROTL(x, 23))
 
-// 消息填充
-void sm3_pad(const uint8_t *msg, size_t len, uint8_t **out, size_t *out_len) {
-    size_t blocks = (len + 1 + 8 + 63) / 64;
-    *out_len = blocks * 64;
-    *out = (uint8_t *)malloc(*out_len);
-    memset(*out, 0, *out_len);
-    memcpy(*out, msg, len);
-    (*out)[len] = 0x80; // 添加比特1
-
-    // 添加长度（大端序）
-    uint64_t bit_len = (uint64_t)len * 8;
-    for (int i = 0; i < 8; i++) {
-        (*out)[*out_len - 8 + i] = (bit_len >> (56 - i * 8)) & 0xFF;
-    }
-}
+// 常量 T_j：前 16 轮 0x79CC4519，后 48 轮 0x7A879D8A。
+// 预计算：ROTL(T_j, j mod 32)，编译期常量，压缩函数中直接查表
+const uint32_t sm3_T_rotl[64] = {
+    0x79CC4519, 0xF3988A32, 0xE7311465, 0xCE6228CB, 0x9CC45197, 0x3988A32F, 0x7311465E, 0xE6228CBC,
+    0xCC451979, 0x988A32F3, 0x311465E7, 0x6228CBCE, 0xC451979C, 0x88A32F39, 0x11465E73, 0x228CBCE6,
+    0x9D8A7A87, 0x3B14F50F, 0x7629EA1E, 0xEC53D43C, 0xD8A7A879, 0xB14F50F3, 0x629EA1E7, 0xC53D43CE,
+    0x8A7A879D, 0x14F50F3B, 0x29EA1E76, 0x53D43CEC, 0xA7A879D8, 0x4F50F3B1, 0x9EA1E762, 0x3D43CEC5,
+    0x7A879D8A, 0xF50F3B14, 0xEA1E7629, 0xD43CEC53, 0xA879D8A7, 0x50F3B14F, 0xA1E7629E, 0x43CEC53D,
+    0x879D8A7A, 0x0F3B14F5, 0x1E7629EA, 0x3CEC53D4, 0x79D8A7A8, 0xF3B14F50, 0xE7629EA1, 0xCEC53D43,
+    0x9D8A7A87, 0x3B14F50F, 0x7629EA1E, 0xEC53D43C, 0xD8A7A879, 0xB14F50F3, 0x629EA1E7, 0xC53D43CE,
+    0x8A7A879D, 0x14F50F3B, 0x29EA1E76, 0x53D43CEC, 0xA7A879D8, 0x4F50F3B1, 0x9EA1E762, 0x3D43CEC5
+};
 
 // 消息扩展
 void sm3_expand(const uint8_t block[64], uint32_t W[68], uint32_t W1[64]) {
@@ -68,7 +60,7 @@ void sm3_compress(uint32_t state[8], const uint32_t W[68], const uint32_t W1[64]
     uint32_t E = state[4], F = state[5], G = state[6], H = state[7];
 
     for (int j = 0; j < 64; j++) {
-        uint32_t SS1 = ROTL((ROTL(A, 12) + E + ROTL(T[j], j)), 7);
+        uint32_t SS1 = ROTL((ROTL(A, 12) + E + sm3_T_rotl[j]), 7);
         uint32_t SS2 = SS1 ^ ROTL(A, 12);
         uint32_t TT1 = (j < 16 ? FF0(A, B, C) : FF1(A, B, C)) + D + SS2 + W1[j];
         uint32_t TT2 = (j < 16 ? GG0(E, F, G) : GG1(E, F, G)) + H + SS1 + W[j];
@@ -80,100 +72,547 @@ void sm3_compress(uint32_t state[8], const uint32_t W[68], const uint32_t W1[64]
     state[4] ^= E; state[5] ^= F; state[6] ^= G; state[7] ^= H;
 }
 
-// 优化：在压缩函数中展开循环
-void sm3_compress_opt1(uint32_t state[8], const uint32_t W[68], const uint32_t W1[64]) {
+// 优化：完全展开的压缩函数，消息扩展在轮函数中进行
+// - 前 16 轮固定 FF0/GG0，后 48 轮固定 FF1/GG1，热路径上没有 j < 16 的判断
+// - T_rotl 为编译期常量，下标全部是字面量
+// - W 只保留 16 个字的滑动窗口：第 j 轮需要 W[j] 和 W[j+4]，W[j+4] 在本轮之前算出并覆盖
+//   已不再使用的 W[j-12]；W'[j] = W[j] ^ W[j+4] 当场计算，不再有 68+64 字的数组
+// - 每轮不搬移 8 个寄存器，而是轮换宏参数的位置，4 轮后回到原排列
+#define SM3_ROUND(A, B, C, D, E, F, G, H, j, FF, GG) do {           \
+        uint32_t A12 = ROTL(A, 12);                                 \
+        uint32_t SS1 = ROTL(A12 + E + sm3_T_rotl[j], 7);            \
+        uint32_t SS2 = SS1 ^ A12;                                   \
+        uint32_t Wj = w[(j) & 15];                                  \
+        uint32_t W1j = Wj ^ w[((j) + 4) & 15];                      \
+        D = FF(A, B, C) + D + SS2 + W1j;                            \
+        H = GG(E, F, G) + H + SS1 + Wj;                             \
+        B = ROTL(B, 9);                                             \
+        F = ROTL(F, 19);                                            \
+        H = P0(H);                                                  \
+    } while (0)
+
+// 计算 W[i]，写入窗口槽位 i mod 16（原先存放的 W[i-16] 是本式最后一次使用）
+#define SM3_EXPAND(i)                                               \
+    (w[(i) & 15] = P1(w[(i) & 15] ^ w[((i) - 9) & 15] ^ ROTL(w[((i) - 3) & 15], 15)) ^ \
+                   ROTL(w[((i) - 13) & 15], 7) ^ w[((i) - 6) & 15])
+#define SM3_NO_EXPAND(i) ((void)0)
+
+// 第 j..j+3 轮；EXP 为 SM3_EXPAND 时每轮先算出 W[j+4]
+#define SM3_ROUND4(j, FF, GG, EXP) do {                             \
+        EXP((j) + 4); SM3_ROUND(A, B, C, D, E, F, G, H, (j), FF, GG);     \
+        EXP((j) + 5); SM3_ROUND(D, A, B, C, H, E, F, G, (j) + 1, FF, GG); \
+        EXP((j) + 6); SM3_ROUND(C, D, A, B, G, H, E, F, (j) + 2, FF, GG); \
+        EXP((j) + 7); SM3_ROUND(B, C, D, A, F, G, H, E, (j) + 3, FF, GG); \
+    } while (0)
+
+void sm3_compress_unrolled(uint32_t state[8], const uint8_t block[64]) {
     uint32_t A = state[0], B = state[1], C = state[2], D = state[3];
     uint32_t E = state[4], F = state[5], G = state[6], H = state[7];
+    uint32_t w[16];
 
-    for (int j = 0; j < 64; j += 4) {
-        // 第1轮
-        uint32_t SS1 = ROTL((ROTL(A, 12) + E + ROTL(T[j], j)), 7);
-        uint32_t SS2 = SS1 ^ ROTL(A, 12);
-        uint32_t TT1 = (j < 16 ? FF0(A, B, C) : FF1(A, B, C)) + D + SS2 + W1[j];
-        uint32_t TT2 = (j < 16 ? GG0(E, F, G) : GG1(E, F, G)) + H + SS1 + W[j];
-        D = C; C = ROTL(B, 9); B = A; A = TT1;
-        H = G; G = ROTL(F, 19); F = E; E = P0(TT2);
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((uint32_t)block[i * 4] << 24) |
+               ((uint32_t)block[i * 4 + 1] << 16) |
+               ((uint32_t)block[i * 4 + 2] << 8) |
+               block[i * 4 + 3];
+    }
+
+    // 第 0~11 轮用到的 W[0..15] 已就绪
+    SM3_ROUND4(0, FF0, GG0, SM3_NO_EXPAND);
+    SM3_ROUND4(4, FF0, GG0, SM3_NO_EXPAND);
+    SM3_ROUND4(8, FF0, GG0, SM3_NO_EXPAND);
+    SM3_ROUND4(12, FF0, GG0, SM3_EXPAND);
+    SM3_ROUND4(16, FF1, GG1, SM3_EXPAND);
+    SM3_ROUND4(20, FF1, GG1, SM3_EXPAND);
+    SM3_ROUND4(24, FF1, GG1, SM3_EXPAND);
+    SM3_ROUND4(28, FF1, GG1, SM3_EXPAND);
+    SM3_ROUND4(32, FF1, GG1, SM3_EXPAND);
+    SM3_ROUND4(36, FF1, GG1, SM3_EXPAND);
+    SM3_ROUND4(40, FF1, GG1, SM3_EXPAND);
+    SM3_ROUND4(44, FF1, GG1, SM3_EXPAND);
+    SM3_ROUND4(48, FF1, GG1, SM3_EXPAND);
+    SM3_ROUND4(52, FF1, GG1, SM3_EXPAND);
+    SM3_ROUND4(56, FF1, GG1, SM3_EXPAND);
+    SM3_ROUND4(60, FF1, GG1, SM3_EXPAND);
+
+    state[0] ^= A; state[1] ^= B; state[2] ^= C; state[3] ^= D;
+    state[4] ^= E; state[5] ^= F; state[6] ^= G; state[7] ^= H;
+}
+
+#ifdef SM3_X86
+// 优化：SIMD 消息扩展（单条消息）
+// W[i] 依赖 W[i-3]，所以一个 128 位向量一次只能得到 W[i..i+2] 三个字（第 4 个元素是无效值，
+// 由下一步覆盖）；同一步里顺便算出 W'[i-4..i-2] = W[i-4..i-2] ^ W[i..i+2]。
+// 每 3 轮标量压缩之前执行一步扩展，向量单元上的扩展与整数单元上的轮函数可以在乱序执行中重叠。
+// 只用到 4 个元素中的 3 个，AVX2 的 256 位向量对这种依赖链没有帮助，因此基础版本只需要 SSSE3；
+// 支持 AVX-512VL 时改用 128 位的 VPROLD / VPTERNLOGD。sm3_compress_blocks 在运行时选择最快的版本
+#define SM3_TARGET_SSSE3 __attribute__((target("ssse3")))
 
-        // 第2轮（j+1）... 类似处理
-        // 第3轮（j+2）...
-        // 第4轮（j+3）...
+#define SM3_LD128(p) _mm_loadu_si128((const __m128i *)(p))
+#define SM3_ST128(p, x) _mm_storeu_si128((__m128i *)(p), x)
+#define SM3_ROL128(x, n) _mm_or_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - (n)))
+#define SM3_XOR3_128(a, b, c) _mm_xor_si128(_mm_xor_si128(a, b), c)
+
+// 计算 W[i..i+2] 与 W'[i-4..i-2]，ROL / XOR3 由具体指令集提供
+#define SM3_SIMD_SCHED(i, ROL, XOR3) do {                                              \
+        __m128i x = XOR3(SM3_LD128(W + (i) - 16), SM3_LD128(W + (i) - 9),              \
+                         ROL(SM3_LD128(W + (i) - 3), 15));                             \
+        x = XOR3(x, ROL(x, 15), ROL(x, 23));                                           \
+        x = XOR3(x, ROL(SM3_LD128(W + (i) - 13), 7), SM3_LD128(W + (i) - 6));          \
+        SM3_ST128(W + (i), x);                                                         \
+        SM3_ST128(W1 + (i) - 4, _mm_xor_si128(SM3_LD128(W + (i) - 4), x));             \
+    } while (0)
+
+// 与 SM3_ROUND 相同，W/W' 从数组读取
+#define SM3_ARR_ROUND(A, B, C, D, E, F, G, H, j, FF, GG) do {       \
+        uint32_t A12 = ROTL(A, 12);                                 \
+        uint32_t SS1 = ROTL(A12 + E + sm3_T_rotl[j], 7);            \
+        uint32_t SS2 = SS1 ^ A12;                                   \
+        D = FF(A, B, C) + D + SS2 + W1[j];                          \
+        H = GG(E, F, G) + H + SS1 + W[j];                           \
+        B = ROTL(B, 9);                                             \
+        F = ROTL(F, 19);                                            \
+        H = P0(H);                                                  \
+    } while (0)
+
+// 压缩函数主体：向量扩展与标量轮函数交错，SCHED(i) 为一步向量扩展。
+// 每步多写一个无效字，W 写到 W[70]，W' 写到 W'[66]；W[16] 预先清零，避免第一步读到未初始化的值。
+// 第 j 轮（j ≥ 12 且为 3 的倍数）之前算出 W[j+4..j+6] 与 W'[j..j+2]
+#define SM3_SIMD_COMPRESS_BODY(SCHED)                                                   \
+    uint32_t A = state[0], B = state[1], C = state[2], D = state[3];                    \
+    uint32_t E = state[4], F = state[5], G = state[6], H = state[7];                    \
+    uint32_t W[72], W1[68];                                                             \
+                                                                                        \
+    __m128i bswap = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12); \
+    __m128i w0 = _mm_shuffle_epi8(SM3_LD128(block), bswap);                             \
+    __m128i w1 = _mm_shuffle_epi8(SM3_LD128(block + 16), bswap);                        \
+    __m128i w2 = _mm_shuffle_epi8(SM3_LD128(block + 32), bswap);                        \
+    __m128i w3 = _mm_shuffle_epi8(SM3_LD128(block + 48), bswap);                        \
+    SM3_ST128(W, w0);                                                                   \
+    SM3_ST128(W + 4, w1);                                                               \
+    SM3_ST128(W + 8, w2);                                                               \
+    SM3_ST128(W + 12, w3);                                                              \
+    SM3_ST128(W + 16, _mm_setzero_si128());                                             \
+    SM3_ST128(W1, _mm_xor_si128(w0, w1));                                               \
+    SM3_ST128(W1 + 4, _mm_xor_si128(w1, w2));                                           \
+    SM3_ST128(W1 + 8, _mm_xor_si128(w2, w3));                                           \
+                                                                                        \
+    SM3_ARR_ROUND(A, B, C, D, E, F, G, H, 0, FF0, GG0);                                 \
+    SM3_ARR_ROUND(D, A, B, C, H, E, F, G, 1, FF0, GG0);                                 \
+    SM3_ARR_ROUND(C, D, A, B, G, H, E, F, 2, FF0, GG0);                                 \
+    SM3_ARR_ROUND(B, C, D, A, F, G, H, E, 3, FF0, GG0);                                 \
+    SM3_ARR_ROUND(A, B, C, D, E, F, G, H, 4, FF0, GG0);                                 \
+    SM3_ARR_ROUND(D, A, B, C, H, E, F, G, 5, FF0, GG0);                                 \
+    SM3_ARR_ROUND(C, D, A, B, G, H, E, F, 6, FF0, GG0);                                 \
+    SM3_ARR_ROUND(B, C, D, A, F, G, H, E, 7, FF0, GG0);                                 \
+    SM3_ARR_ROUND(A, B, C, D, E, F, G, H, 8, FF0, GG0);                                 \
+    SM3_ARR_ROUND(D, A, B, C, H, E, F, G, 9, FF0, GG0);                                 \
+    SM3_ARR_ROUND(C, D, A, B, G, H, E, F, 10, FF0, GG0);                                \
+    SM3_ARR_ROUND(B, C, D, A, F, G, H, E, 11, FF0, GG0);                                \
+    SCHED(16);                                                                          \
+    SM3_ARR_ROUND(A, B, C, D, E, F, G, H, 12, FF0, GG0);                                \
+    SM3_ARR_ROUND(D, A, B, C, H, E, F, G, 13, FF0, GG0);                                \
+    SM3_ARR_ROUND(C, D, A, B, G, H, E, F, 14, FF0, GG0);                                \
+    SCHED(19);                                                                          \
+    SM3_ARR_ROUND(B, C, D, A, F, G, H, E, 15, FF0, GG0);                                \
+    SM3_ARR_ROUND(A, B, C, D, E, F, G, H, 16, FF1, GG1);                                \
+    SM3_ARR_ROUND(D, A, B, C, H, E, F, G, 17, FF1, GG1);                                \
+    SCHED(22);                                                                          \
+    SM3_ARR_ROUND(C, D, A, B, G, H, E, F, 18, FF1, GG1);                                \
+    SM3_ARR_ROUND(B, C, D, A, F, G, H, E, 19, FF1, GG1);                                \
+    SM3_ARR_ROUND(A, B, C, D, E, F, G, H, 20, FF1, GG1);                                \
+    SCHED(25);                                                                          \
+    SM3_ARR_ROUND(D, A, B, C, H, E, F, G, 21, FF1, GG1);                                \
+    SM3_ARR_ROUND(C, D, A, B, G, H, E, F, 22, FF1, GG1);                                \
+    SM3_ARR_ROUND(B, C, D, A, F, G, H, E, 23, FF1, GG1);                                \
+    SCHED(28);                                                                          \
+    SM3_ARR_ROUND(A, B, C, D, E, F, G, H, 24, FF1, GG1);                                \
+    SM3_ARR_ROUND(D, A, B, C, H, E, F, G, 25, FF1, GG1);                                \
+    SM3_ARR_ROUND(C, D, A, B, G, H, E, F, 26, FF1, GG1);                                \
+    SCHED(31);                                                                          \
+    SM3_ARR_ROUND(B, C, D, A, F, G, H, E, 27, FF1, GG1);                                \
+    SM3_ARR_ROUND(A, B, C, D, E, F, G, H, 28, FF1, GG1);                                \
+    SM3_ARR_ROUND(D, A, B, C, H, E, F, G, 29, FF1, GG1);                                \
+    SCHED(34);                                                                          \
+    SM3_ARR_ROUND(C, D, A, B, G, H, E, F, 30, FF1, GG1);                                \
+    SM3_ARR_ROUND(B, C, D, A, F, G, H, E, 31, FF1, GG1);                                \
+    SM3_ARR_ROUND(A, B, C, D, E, F, G, H, 32, FF1, GG1);                                \
+    SCHED(37);                                                                          \
+    SM3_ARR_ROUND(D, A, B, C, H, E, F, G, 33, FF1, GG1);                                \
+    SM3_ARR_ROUND(C, D, A, B, G, H, E, F, 34, FF1, GG1);                                \
+    SM3_ARR_ROUND(B, C, D, A, F, G, H, E, 35, FF1, GG1);                                \
+    SCHED(40);                                                                          \
+    SM3_ARR_ROUND(A, B, C, D, E, F, G, H, 36, FF1, GG1);                                \
+    SM3_ARR_ROUND(D, A, B, C, H, E, F, G, 37, FF1, GG1);                                \
+    SM3_ARR_ROUND(C, D, A, B, G, H, E, F, 38, FF1, GG1);                                \
+    SCHED(43);                                                                          \
+    SM3_ARR_ROUND(B, C, D, A, F, G, H, E, 39, FF1, GG1);                                \
+    SM3_ARR_ROUND(A, B, C, D, E, F, G, H, 40, FF1, GG1);                                \
+    SM3_ARR_ROUND(D, A, B, C, H, E, F, G, 41, FF1, GG1);                                \
+    SCHED(46);                                                                          \
+    SM3_ARR_ROUND(C, D, A, B, G, H, E, F, 42, FF1, GG1);                                \
+    SM3_ARR_ROUND(B, C, D, A, F, G, H, E, 43, FF1, GG1);                                \
+    SM3_ARR_ROUND(A, B, C, D, E, F, G, H, 44, FF1, GG1);                                \
+    SCHED(49);                                                                          \
+    SM3_ARR_ROUND(D, A, B, C, H, E, F, G, 45, FF1, GG1);                                \
+    SM3_ARR_ROUND(C, D, A, B, G, H, E, F, 46, FF1, GG1);                                \
+    SM3_ARR_ROUND(B, C, D, A, F, G, H, E, 47, FF1, GG1);                                \
+    SCHED(52);                                                                          \
+    SM3_ARR_ROUND(A, B, C, D, E, F, G, H, 48, FF1, GG1);                                \
+    SM3_ARR_ROUND(D, A, B, C, H, E, F, G, 49, FF1, GG1);                                \
+    SM3_ARR_ROUND(C, D, A, B, G, H, E, F, 50, FF1, GG1);                                \
+    SCHED(55);                                                                          \
+    SM3_ARR_ROUND(B, C, D, A, F, G, H, E, 51, FF1, GG1);                                \
+    SM3_ARR_ROUND(A, B, C, D, E, F, G, H, 52, FF1, GG1);                                \
+    SM3_ARR_ROUND(D, A, B, C, H, E, F, G, 53, FF1, GG1);                                \
+    SCHED(58);                                                                          \
+    SM3_ARR_ROUND(C, D, A, B, G, H, E, F, 54, FF1, GG1);                                \
+    SM3_ARR_ROUND(B, C, D, A, F, G, H, E, 55, FF1, GG1);                                \
+    SM3_ARR_ROUND(A, B, C, D, E, F, G, H, 56, FF1, GG1);                                \
+    SCHED(61);                                                                          \
+    SM3_ARR_ROUND(D, A, B, C, H, E, F, G, 57, FF1, GG1);                                \
+    SM3_ARR_ROUND(C, D, A, B, G, H, E, F, 58, FF1, GG1);                                \
+    SM3_ARR_ROUND(B, C, D, A, F, G, H, E, 59, FF1, GG1);                                \
+    SCHED(64);                                                                          \
+    SM3_ARR_ROUND(A, B, C, D, E, F, G, H, 60, FF1, GG1);                                \
+    SM3_ARR_ROUND(D, A, B, C, H, E, F, G, 61, FF1, GG1);                                \
+    SM3_ARR_ROUND(C, D, A, B, G, H, E, F, 62, FF1, GG1);                                \
+    SCHED(67);                                                                          \
+    SM3_ARR_ROUND(B, C, D, A, F, G, H, E, 63, FF1, GG1);                                \
+                                                                                        \
+    state[0] ^= A; state[1] ^= B; state[2] ^= C; state[3] ^= D;                         \
+    state[4] ^= E; state[5] ^= F; state[6] ^= G; state[7] ^= H;
+
+#define SM3_SSSE3_ROL(x, n) SM3_ROL128(x, n)
+#define SM3_SSSE3_SCHED(i) SM3_SIMD_SCHED(i, SM3_SSSE3_ROL, SM3_XOR3_128)
+
+SM3_TARGET_SSSE3
+static void sm3_compress_ssse3(uint32_t state[8], const uint8_t block[64]) {
+    SM3_SIMD_COMPRESS_BODY(SM3_SSSE3_SCHED);
+}
+
+// AVX-512VL：128 位向量上的 VPROLD 与 VPTERNLOGD，每步扩展的指令数约减半
+#define SM3_TARGET_AVX512VL __attribute__((target("avx512f,avx512vl")))
+#define SM3_VL_ROL(x, n) _mm_rol_epi32(x, n)
+#define SM3_VL_XOR3(a, b, c) _mm_ternarylogic_epi32(a, b, c, 0x96)
+#define SM3_VL_SCHED(i) SM3_SIMD_SCHED(i, SM3_VL_ROL, SM3_VL_XOR3)
+
+SM3_TARGET_AVX512VL
+static void sm3_compress_avx512vl(uint32_t state[8], const uint8_t block[64]) {
+    SM3_SIMD_COMPRESS_BODY(SM3_VL_SCHED);
+}
+
+static int sm3_ssse3_supported(void) {
+    return __builtin_cpu_supports("ssse3");
+}
+
+static int sm3_avx512vl_supported(void) {
+    return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl");
+}
+#endif
+
+// 初始向量
+static const uint32_t SM3_IV[8] = {
+    0x7380166F, 0x4914B2B9, 0x172442D7, 0xDA8A0600,
+    0xA96F30BC, 0x163138AA, 0xE38DEE4D, 0xB0FB0E4E
+};
+
+typedef void (*sm3_compress_fn)(uint32_t state[8], const uint8_t block[64]);
+
+// 按 CPUID 选择单条消息的压缩函数：avx512vl > ssse3 > 纯标量展开版
+static sm3_compress_fn sm3_select_compress(void) {
+#ifdef SM3_X86
+    if (sm3_avx512vl_supported()) {
+        return sm3_compress_avx512vl;
+    }
+    if (sm3_ssse3_supported()) {
+        return sm3_compress_ssse3;
     }
+#endif
+    return sm3_compress_unrolled;
+}
 
-    state[0] ^= A; // 更新状态...
+static sm3_compress_fn sm3_compress_active = NULL;
+
+// 启动时选好压缩函数，之后只读
+__attribute__((constructor)) static void sm3_compress_init(void) {
+#ifdef SM3_X86
+    __builtin_cpu_init();
+#endif
+    sm3_compress_active = sm3_select_compress();
+}
+
+// 连续压缩整分组：直接读调用者的缓冲区，不复制
+void sm3_compress_blocks(uint32_t state[8], const uint8_t *data, size_t nblocks) {
+    sm3_compress_fn compress = sm3_compress_active;
+    if (compress == NULL) {
+        sm3_compress_init();
+        compress = sm3_compress_active;
+    }
+    for (size_t i = 0; i < nblocks; i++) {
+        compress(state, data + i * SM3_BLOCK_SIZE);
+    }
+}
+
+// ---------- 流式接口 ----------
+void sm3_init(sm3_ctx *ctx) {
+    sm3_init_from_state(ctx, SM3_IV, 0);
+}
+
+void sm3_init_from_state(sm3_ctx *ctx, const uint32_t iv[8], uint64_t processed_len) {
+    memcpy(ctx->state, iv, sizeof(ctx->state));
+    ctx->buf_len = 0;
+    ctx->total_len = processed_len;
+}
+
+void sm3_update(sm3_ctx *ctx, const uint8_t *data, size_t len) {
+    ctx->total_len += len;
+
+    // 先凑满上次剩下的不完整分组
+    if (ctx->buf_len > 0) {
+        size_t n = SM3_BLOCK_SIZE - ctx->buf_len;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(ctx->buf + ctx->buf_len, data, n);
+        ctx->buf_len += n;
+        data += n;
+        len -= n;
+        if (ctx->buf_len < SM3_BLOCK_SIZE) {
+            return;
+        }
+        sm3_compress_blocks(ctx->state, ctx->buf, 1);
+        ctx->buf_len = 0;
+    }
+
+    // 整分组直接压缩
+    size_t nblocks = len / SM3_BLOCK_SIZE;
+    sm3_compress_blocks(ctx->state, data, nblocks);
+    data += nblocks * SM3_BLOCK_SIZE;
+    len -= nblocks * SM3_BLOCK_SIZE;
+
+    memcpy(ctx->buf, data, len);
+    ctx->buf_len = len;
+}
+
+// 填充只作用于最后不足一个分组的部分：0x80 || 0...0 || [比特长度]_64，至多两个分组，全部在栈上
+void sm3_final(sm3_ctx *ctx, uint8_t digest[SM3_DIGEST_SIZE]) {
+    uint8_t block[2 * SM3_BLOCK_SIZE] = {0};
+    size_t n = ctx->buf_len;
+    memcpy(block, ctx->buf, n);
+    block[n] = 0x80; // 添加比特1
+
+    size_t blocks = n + 1 + 8 > SM3_BLOCK_SIZE ? 2 : 1;
+    uint64_t bit_len = ctx->total_len * 8;
+    for (int i = 0; i < 8; i++) {
+        block[blocks * SM3_BLOCK_SIZE - 8 + i] = (bit_len >> (56 - i * 8)) & 0xFF;
+    }
+    sm3_compress_blocks(ctx->state, block, blocks);
+
+    // 输出大端序结果
+    for (int i = 0; i < 8; i++) {
+        digest[i * 4] = (ctx->state[i] >> 24) & 0xFF;
+        digest[i * 4 + 1] = (ctx->state[i] >> 16) & 0xFF;
+        digest[i * 4 + 2] = (ctx->state[i] >> 8) & 0xFF;
+        digest[i * 4 + 3] = ctx->state[i] & 0xFF;
+    }
 }
 
-// 预计算：预先计算 ROTL(T[j], j) 的值
-static uint32_t T_rotl[64];
-void init_T_rotl() {
-    for (int j = 0; j < 64; j++) {
-        T_rotl[j] = ROTL(T[j], j % 32);
-    }
-}
-
-// 优化：使用AVX2处理4个消息块并行
-// void sm3_compress_avx2(__m256i state[8], const __m256i W[68]) {
-//     __m256i A = state[0], B = state[1], ...;
-//     for (int j = 0; j < 64; j++) {
-//         // 使用_mm256_xxx指令实现并行计算
-//         __m256i SS1 = _mm256_rotl_epi32(...);
-//         // ... 其他操作
-//     }
-//     state[0] = _mm256_xor_si256(state[0], A);
-//     // ... 更新其他状态
-// }
-
-// 优化：合并消息扩展与压缩
-// void sm3_process_block(uint32_t state[8], const uint8_t block[64]) {
-//     uint32_t W[68], W1[64];
-//     // 扩展与压缩合并，避免多次访问内存
-//     for (int i = 0; i < 16; i++) {
-//         W[i] = ...; // 直接计算
-//     }
-//     for (int i = 16; i < 68; i++) {
-//         W[i] = ...; // 计算W
-//         if (i >= 4) W1[i - 4] = W[i - 4] ^ W[i]; // 提前计算W1
-//     }
-//     // 立即调用压缩函数
-//     sm3_compress_opt(state, W, W1);
-// }
-
-// 消除分支：使用掩码替代条件分支
-#define FF(x, y, z, j) (((j) < 16) ? FF0(x, y, z) : FF1(x, y, z))
-#define GG(x, y, z, j) (((j) < 16) ? GG0(x, y, z) : GG1(x, y, z))
-
-// 或使用查表法（示例）
-// static uint32_t FF_table[2] = {FF0, FF1}; // 伪代码，实际需封装函数指针
-
-// 压缩函数中使用预计算值
-// uint32_t SS1 = ROTL((ROTL(A, 12) + E + T_rotl[j]), 7); // 替换原计算
 // SM3主函数
 void sm3_hash(const uint8_t *msg, size_t len, uint8_t digest[32]) {
-    // 初始向量
-    uint32_t state[8] = {
-        0x7380166F, 0x4914B2B9, 0x172442D7, 0xDA8A0600,
-        0xA96F30BC, 0x163138AA, 0xE38DEE4D, 0xB0FB0E4E
+    sm3_ctx ctx;
+    sm3_init(&ctx);
+    sm3_update(&ctx, msg, len);
+    sm3_final(&ctx, digest);
+}
+
+// 从自定义IV计算哈希
+void sm3_hash_from_iv(const uint32_t iv[8], const uint8_t *msg, size_t len, uint8_t digest[32]) {
+    sm3_ctx ctx;
+    sm3_init_from_state(&ctx, iv, 0);
+    sm3_update(&ctx, msg, len);
+    sm3_final(&ctx, digest);
+}
+
+
+#ifndef SM3_NO_MAIN
+// 参考实现：sm3_expand + sm3_compress
+static void sm3_compress_ref(uint32_t state[8], const uint8_t block[64]) {
+    uint32_t W[68], W1[64];
+    sm3_expand(block, W, W1);
+    sm3_compress(state, W, W1);
+}
+
+static int sm3_always_supported(void) {
+    return 1;
+}
+
+// 参与自检与性能对比的压缩函数，第一个为参考实现
+static const struct {
+    const char *name;
+    void (*compress)(uint32_t state[8], const uint8_t block[64]);
+    int (*supported)(void);
+} sm3_variants[] = {
+    {"sm3_expand + sm3_compress", sm3_compress_ref, sm3_always_supported},
+    {"sm3_compress_unrolled", sm3_compress_unrolled, sm3_always_supported},
+#ifdef SM3_X86
+    {"sm3_compress_ssse3", sm3_compress_ssse3, sm3_ssse3_supported},
+    {"sm3_compress_avx512vl", sm3_compress_avx512vl, sm3_avx512vl_supported},
+#endif
+};
+#define SM3_NVARIANTS (sizeof(sm3_variants) / sizeof(sm3_variants[0]))
+
+#ifdef SM3_X86
+#define SM3_CYCLES() __rdtsc()
+#else
+#define SM3_CYCLES() ((uint64_t)clock() * (3000000000ULL / CLOCKS_PER_SEC)) // 无 rdtsc 时按 3 GHz 估算
+#endif
+
+static void print_digest(const uint8_t digest[32]) {
+    for (int i = 0; i < 32; i++) {
+        printf("%02x", digest[i]);
+    }
+}
+
+// GB/T 32905-2016 附录 A 的两个示例，以及随机分块的流式输入与一次性结果比较
+static void sm3_self_test(void) {
+    static const uint8_t expect_abc[32] = {
+        0x66, 0xC7, 0xF0, 0xF4, 0x62, 0xEE, 0xED, 0xD9, 0xD1, 0xF2, 0xD4, 0x6B, 0xDC, 0x10, 0xE4, 0xE2,
+        0x41, 0x67, 0xC4, 0x87, 0x5C, 0xF2, 0xF7, 0xA2, 0x29, 0x7D, 0xA0, 0x2B, 0x8F, 0x4B, 0xA8, 0xE0
+    };
+    static const uint8_t expect_abcd16[32] = {
+        0xDE, 0xBE, 0x9F, 0xF9, 0x22, 0x75, 0xB8, 0xA1, 0x38, 0x60, 0x48, 0x89, 0xC1, 0x8E, 0x5A, 0x4D,
+        0x6F, 0xDB, 0x70, 0xE5, 0x38, 0x7E, 0x57, 0x65, 0x29, 0x3D, 0xCB, 0xA3, 0x9C, 0x0C, 0x57, 0x32
     };
+    uint8_t digest[32], msg[64];
 
-    // 消息填充
-    uint8_t *padded_msg;
-    size_t padded_len;
-    sm3_pad(msg, len, &padded_msg, &padded_len);
+    sm3_hash((const uint8_t *)"abc", 3, digest);
+    printf("SM3(\"abc\") = ");
+    print_digest(digest);
+    printf("  %s\n", memcmp(digest, expect_abc, 32) == 0 ? "OK" : "FAIL");
 
-    // 处理每个分组
-    size_t blocks = padded_len / 64;
-    for (size_t i = 0; i < blocks; i++) {
-        uint32_t W[68], W1[64];
-        sm3_expand(padded_msg + i * 64, W, W1);
-        sm3_compress(state, W, W1);
+    for (int i = 0; i < 64; i++) {
+        msg[i] = "abcd"[i % 4];
     }
+    sm3_hash(msg, 64, digest);
+    printf("SM3(\"abcd\" x 16) = ");
+    print_digest(digest);
+    printf("  %s\n", memcmp(digest, expect_abcd16, 32) == 0 ? "OK" : "FAIL");
 
-    // 输出大端序结果
-    for (int i = 0; i < 8; i++) {
-        digest[i * 4] = (state[i] >> 24) & 0xFF;
-        digest[i * 4 + 1] = (state[i] >> 16) & 0xFF;
-        digest[i * 4 + 2] = (state[i] >> 8) & 0xFF;
-        digest[i * 4 + 3] = state[i] & 0xFF;
+    // 流式：长度 0..300，每次随机分块
+    static uint8_t data[300];
+    int ok = 1;
+    srand(15);
+    for (int i = 0; i < 300; i++) {
+        data[i] = rand() & 0xFF;
+    }
+    for (size_t len = 0; len <= 300; len++) {
+        uint8_t expect[32];
+        sm3_hash(data, len, expect);
+        sm3_ctx ctx;
+        sm3_init(&ctx);
+        for (size_t off = 0; off < len;) {
+            size_t n = 1 + rand() % 100;
+            if (n > len - off) {
+                n = len - off;
+            }
+            sm3_update(&ctx, data + off, n);
+            off += n;
+        }
+        sm3_final(&ctx, digest);
+        ok &= memcmp(digest, expect, 32) == 0;
     }
+    printf("streaming (random chunks) vs one-shot: %s\n", ok ? "OK" : "FAIL");
 
-    free(padded_msg);
-}
\ No newline at end of file
+    // 各压缩函数与参考实现逐分组比较（链式，状态随机）
+    for (size_t k = 1; k < SM3_NVARIANTS; k++) {
+        if (!sm3_variants[k].supported()) {
+            continue;
+        }
+        uint32_t s1[8], s2[8];
+        for (int i = 0; i < 8; i++) {
+            s1[i] = s2[i] = (uint32_t)rand() << 16 ^ rand();
+        }
+        ok = 1;
+        for (int n = 0; n < 10000; n++) {
+            uint8_t block[64];
+            for (int i = 0; i < 64; i++) {
+                block[i] = rand() & 0xFF;
+            }
+            sm3_compress_ref(s1, block);
+            sm3_variants[k].compress(s2, block);
+            ok &= memcmp(s1, s2, sizeof(s1)) == 0;
+        }
+        printf("%s vs sm3_compress: %s\n", sm3_variants[k].name, ok ? "OK" : "FAIL");
+    }
+}
+
+// 压缩函数性能对比：同一 1 MB 缓冲区重复压缩，取最好一次的 cycles/byte
+static void sm3_bench_compress(void) {
+    enum { BENCH_BLOCKS = 1 << 14, BENCH_RUNS = 8 };
+    static uint8_t data[BENCH_BLOCKS * SM3_BLOCK_SIZE];
+    uint32_t state[8] = {0};
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)i;
+    }
+
+    double best[SM3_NVARIANTS];
+    for (size_t k = 0; k < SM3_NVARIANTS; k++) {
+        best[k] = 1e30;
+    }
+    // 各实现交替运行，减少频率变化带来的偏差
+    for (int r = 0; r < BENCH_RUNS; r++) {
+        for (size_t k = 0; k < SM3_NVARIANTS; k++) {
+            if (!sm3_variants[k].supported()) {
+                continue;
+            }
+            uint64_t t0 = SM3_CYCLES();
+            for (size_t i = 0; i < BENCH_BLOCKS; i++) {
+                sm3_variants[k].compress(state, data + i * SM3_BLOCK_SIZE);
+            }
+            double cpb = (double)(SM3_CYCLES() - t0) / sizeof(data);
+            if (cpb < best[k]) best[k] = cpb;
+        }
+    }
+    printf("\n压缩函数性能 (cycles/byte, 1 MB x %d 次取最好)\n", BENCH_RUNS);
+    for (size_t k = 0; k < SM3_NVARIANTS; k++) {
+        if (!sm3_variants[k].supported()) {
+            printf("  %-26s:   不支持\n", sm3_variants[k].name);
+        } else {
+            printf("  %-26s: %6.2f  (%.2fx)\n", sm3_variants[k].name, best[k], best[0] / best[k]);
+        }
+    }
+    printf("  (state %08x，防止被优化掉)\n", state[0]);
+}
+
+// 不带参数运行自检；带文件名时以 64 KB 缓冲区流式计算各文件的 SM3，内存占用与文件大小无关
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        sm3_self_test();
+        sm3_bench_compress();
+        return 0;
+    }
+    static uint8_t buf[1 << 16];
+    int status = 0;
+    for (int i = 1; i < argc; i++) {
+        FILE *f = fopen(argv[i], "rb");
+        if (f == NULL) {
+            perror(argv[i]);
+            status = 1;
+            continue;
+        }
+        sm3_ctx ctx;
+        sm3_init(&ctx);
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+            sm3_update(&ctx, buf, n);
+        }
+        fclose(f);
+        uint8_t digest[32];
+        sm3_final(&ctx, digest);
+        print_digest(digest);
+        printf("  %s\n", argv[i]);
+    }
+    return status;
+}
+#endif